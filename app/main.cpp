@@ -1,5 +1,6 @@
 
 #include <flan/data_source_delegate.hpp>
+#include <flan/data_source_delegate_provider_file.hpp>
 #include <flan/data_source_delegate_provider_scratch_buffer.hpp>
 #include <flan/data_source_delegate_provider_serial_port.hpp>
 #include <flan/data_source_delegate_provider_stdin.hpp>
@@ -74,6 +75,11 @@ timestamp_format_list_t get_initial_timestamp_formats()
     return formats;
 }
 
+options_t get_initial_options()
+{
+    return load_options_from_json(get_default_settings_file_for_options());
+}
+
 QString get_initial_text_log()
 {
     // Define FLAN_USE_DEFAULT_TEXT_LOG to load a default text log.
@@ -125,12 +131,16 @@ int main(int argc, char** argv)
     main_widget->set_model(&rule_model);
     main_widget->set_content(get_initial_text_log());
     main_widget->set_timestamp_formats(get_initial_timestamp_formats());
+    if (auto max_line_size = get_initial_options().max_line_size)
+        main_widget->set_max_line_size(*max_line_size);
 
     std::vector<data_source_delegate_provider_t*> provider_list;
     data_source_delegate_provider_scratch_buffer_t scratch_buffer_provider;
     provider_list.push_back(&scratch_buffer_provider);
     data_source_delegate_provider_stdin_t stdin_provider;
     provider_list.push_back(&stdin_provider);
+    data_source_delegate_provider_file_t file_provider;
+    provider_list.push_back(&file_provider);
     data_source_delegate_provider_serial_port_t serial_port_provider;
     provider_list.push_back(&serial_port_provider);
 
@@ -170,6 +180,8 @@ int main(int argc, char** argv)
             save_timestamp_formats_to_json(
                 main_widget->timestamp_formats(),
                 get_default_settings_file_for_timestamp_formats());
+            save_options_to_json(
+                options_t{main_widget->max_line_size()}, get_default_settings_file_for_options());
         });
 
     return app.exec();
@@ -1,11 +1,36 @@
 
 #pragma once
 
+#include <flan/line_store.hpp>
 #include <QObject>
 #include <QString>
+#include <vector>
 
 namespace flan
 {
+//! Limits of the content kept from a data source. The oldest lines are removed beyond them.
+struct retention_policy_t
+{
+    //! Maximum number of lines kept, or 0 for no limit.
+    std::size_t max_line_count = 0;
+
+    //! Maximum size of the lines kept in bytes, or 0 for no limit.
+    std::size_t max_byte_count = 0;
+
+    //! Return the default policy of the sources streaming content, which would otherwise use more
+    //! and more memory as long as they are open.
+    static retention_policy_t streaming_default() { return {0, std::size_t{1024} * 1024 * 1024}; }
+
+    bool is_unlimited() const { return (max_line_count == 0) && (max_byte_count == 0); }
+
+    bool operator==(const retention_policy_t& other) const
+    {
+        return (max_line_count == other.max_line_count)
+            && (max_byte_count == other.max_byte_count);
+    }
+    bool operator!=(const retention_policy_t& other) const { return !(*this == other); }
+};
+
 class data_source_t : public QObject
 {
     Q_OBJECT
@@ -17,12 +42,35 @@ public:
     virtual QString text() const = 0;
     virtual QString error_message() const = 0;
 
+    //! Return the blocks of lines already available, which come after text().
+    //!
+    //! Sources with a lot of content provide it as blocks of lines so that it is not copied.
+    virtual std::vector<line_block_ptr_t> line_blocks() const;
+
+    //! Return \c true if the user can edit the content of the source in the log.
+    virtual bool is_editable() const { return false; }
+
+    const retention_policy_t& retention_policy() const { return _retention_policy; }
+    void set_retention_policy(retention_policy_t policy);
+
 signals:
     void new_text(QString text);
 
+    //! Emitted when a new \a block of lines is available.
+    void new_line_block(flan::line_block_ptr_t block);
+
+    //! Emitted when the content previously provided by the source is no longer relevant (e.g. the
+    //! source switched to another file).
+    void content_reset();
+
     //! Emitted every time an error occured with the given \a error_message.
     //!
     //! If the \a error_message is null (QString::isNull()) the error has been cleared.
     void error_changed(QString error_message);
+
+    void retention_policy_changed(flan::retention_policy_t policy);
+
+private:
+    retention_policy_t _retention_policy;
 };
 } // namespace flan
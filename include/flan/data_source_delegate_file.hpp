@@ -0,0 +1,22 @@
+
+#pragma once
+
+#include <flan/data_source_delegate.hpp>
+
+namespace flan
+{
+class data_source_file_t;
+
+class data_source_delegate_file_t : public data_source_delegate_t
+{
+    Q_OBJECT
+
+public:
+    data_source_delegate_file_t(data_source_file_t& data_source, QObject* parent = nullptr);
+
+    QWidget* create_view(QWidget* parent) const override;
+
+private:
+    data_source_file_t& _data_source_file;
+};
+} // namespace flan
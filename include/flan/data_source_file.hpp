@@ -0,0 +1,58 @@
+
+#pragma once
+
+#include <flan/data_source.hpp>
+#include <atomic>
+
+class QThread;
+
+namespace flan
+{
+//! Data source reading the content of a file.
+//!
+//! The file is memory mapped and its lines are indexed in a background thread. The lines are
+//! provided as blocks referencing the mapped memory, the first one being small so that the
+//! beginning of the file is available right away. The content of the file is never copied.
+class data_source_file_t : public data_source_t
+{
+    Q_OBJECT
+
+public:
+    explicit data_source_file_t(QObject* parent = nullptr);
+    ~data_source_file_t() override;
+
+    QString name() const override { return tr("File"); }
+    QString text() const override { return {}; }
+    QString error_message() const override { return _error_message; }
+    std::vector<line_block_ptr_t> line_blocks() const override { return _line_blocks; }
+
+    //! Return the path of the current file, or an empty string if no file is open.
+    const QString& file_path() const { return _file_path; }
+
+public slots:
+    //! Open the file at \a file_path, closing the current one if any.
+    void open(const QString& file_path);
+
+    //! Close the current file.
+    void close();
+
+signals:
+    void file_path_changed(QString file_path);
+
+private:
+    void add_line_block(line_block_ptr_t block);
+    void set_error_message(QString error_message);
+
+private:
+    QString _file_path;
+    QString _error_message;
+    std::vector<line_block_ptr_t> _line_blocks;
+
+    QThread* _indexing_thread = nullptr;
+    std::atomic_bool _stop_indexing{false};
+
+    //! Incremented every time the file is closed, so that blocks from a previous file still in
+    //! flight are dropped.
+    std::size_t _generation = 0;
+};
+} // namespace flan
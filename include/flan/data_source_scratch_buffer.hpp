@@ -15,5 +15,6 @@ public:
     QString name() const override { return tr("Scratch buffer"); }
     QString text() const override { return {}; }
     QString error_message() const override { return {}; }
+    bool is_editable() const override { return true; }
 };
 } // namespace flan
@@ -1,6 +1,8 @@
 
 #pragma once
 
+#include <flan/data_source.hpp>
+#include <QActionGroup>
 #include <QComboBox>
 #include <QHBoxLayout>
 #include <QToolButton>
@@ -9,7 +11,6 @@
 namespace flan
 {
 class elided_label_t;
-class data_source_t;
 class data_source_delegate_t;
 
 class data_source_selection_widget_t : public QWidget
@@ -30,15 +31,21 @@ signals:
 private:
     data_source_delegate_t* current_delegate() const;
 
+    void add_retention_policy(const QString& text, retention_policy_t policy);
+
 private slots:
     void rebuild_custom_widgets();
     void update_error();
+    void update_retention_policy();
 
 private:
     QComboBox* _data_source_combobox = nullptr;
+    QToolButton* _retention_policy_button = nullptr;
+    QActionGroup* _retention_policy_actions = nullptr;
     QHBoxLayout* _current_source_widget_layout = nullptr;
     elided_label_t* _error_label = nullptr;
 
     data_source_delegate_list_t _delegates;
+    std::vector<retention_policy_t> _retention_policies;
 };
 } // namespace flan
@@ -3,17 +3,18 @@
 
 #include <QAction>
 #include <QObject>
-#include <QPlainTextEdit>
 #include <QString>
 
 namespace flan
 {
+class log_widget_t;
+
 class find_controller_t : public QObject
 {
     Q_OBJECT
 
 public:
-    find_controller_t(QPlainTextEdit* text_edit, QObject* parent = nullptr);
+    find_controller_t(log_widget_t* log_widget, QObject* parent = nullptr);
 
     QString pattern() const { return _pattern; }
     bool is_pattern_valid() const;
@@ -36,7 +37,7 @@ private:
     void find(bool search_backward);
 
 private:
-    QPlainTextEdit* _text_edit;
+    log_widget_t* _log_widget;
     QString _pattern;
 
     QAction* _find_action;
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <flan/line_store.hpp>
+#include <flan/line_visibility.hpp>
+#include <flan/multi_pattern_matcher.hpp>
+#include <flan/styled_matching_rule.hpp>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+namespace flan
+{
+//! Decide which lines of a log are shown according to the filtering rules.
+//!
+//! Rules are applied in order and the first rule matching a line decides if it is kept or removed.
+//! A line not matched by any rule is shown according to show_lines_by_default().
+//!
+//! Which lines each rule matches is kept in a bitset per pattern. Changing the behaviour or the
+//! order of the rules, or the default visibility, only combines these bitsets again. A pattern is
+//! only matched against the lines it has never been matched against, and only when a single scan
+//! of the line by a multi_pattern_matcher_t finds that it might match.
+class line_filter_t
+{
+public:
+    //! Number of lines matched by a single task when matching lines in parallel.
+    static constexpr std::size_t lines_per_task = 16 * 1024;
+
+    //! Matching of the lines which have not been matched yet against some patterns.
+    //!
+    //! A job holds copies of everything it needs so that it can run in another thread while the
+    //! filter is used, and its results are then merged into the filter.
+    struct match_job_t
+    {
+        //! The patterns to match, along with the first line to match for each of them.
+        std::vector<QRegularExpression> patterns;
+        std::vector<std::size_t> first_lines;
+
+        //! Lines are matched up to this one, excluded.
+        std::size_t last_line = 0;
+
+        //! Only the first bytes of the lines are matched, see max_line_size().
+        std::size_t max_line_size = 0;
+
+        //! Matcher of the patterns, indexed like the patterns.
+        multi_pattern_matcher_t matcher;
+
+        //! The lines matching each pattern, one bit per line.
+        std::vector<std::vector<std::uint64_t>> words;
+
+        bool is_empty() const { return patterns.empty(); }
+    };
+
+public:
+    //! Set the \a rules used for filtering. Rules with an invalid pattern are ignored.
+    //!
+    //! Only the rules with a filtering behaviour decide which lines are shown. The patterns of the
+    //! other rules are matched as well (see match_job()), so that giving them a filtering behaviour
+    //! later only combines their matches.
+    //!
+    //! Return \c true if the filtering changed, i.e. if the visibility of lines might have changed.
+    bool set_rules(const styled_matching_rule_list_t& rules);
+
+    bool show_lines_by_default() const { return _show_lines_by_default; }
+
+    //! Return \c true if the filtering changed.
+    bool set_show_lines_by_default(bool show_lines_by_default);
+
+    std::size_t max_line_size() const { return _max_line_size; }
+
+    //! Only match the first \a max_line_size bytes of the lines, or whole lines if 0.
+    //!
+    //! Return \c true if the filtering changed, in which case all the lines have to be matched
+    //! again.
+    bool set_max_line_size(std::size_t max_line_size);
+
+    //! Forget the matches of the lines starting at \a first_line, whose content has changed.
+    void forget_lines_from(std::size_t first_line);
+
+    //! Forget the matches of the \a line_count first lines, which have been removed from the log.
+    //! The following lines are then indexed from 0.
+    void remove_first_lines(std::size_t line_count);
+
+    //! Forget the results of the \a job for the \a line_count first lines, which have been removed
+    //! from the log while it was running.
+    static void remove_first_lines(match_job_t& job, std::size_t line_count);
+
+    //! Return the number of lines, from the first one, which have been matched against the
+    //! patterns of all the rules with a filtering behaviour.
+    //!
+    //! Only these lines can be filtered, the other ones have to be matched by a job first.
+    std::size_t matched_line_count() const;
+
+    //! Append to \a visibility which lines are shown, from the first line not in \a visibility up
+    //! to \a last_line, excluded.
+    //!
+    //! This only combines the matches of the rules, so \a last_line must not be after
+    //! matched_line_count().
+    void shown_lines(std::size_t last_line, line_visibility_t& visibility) const;
+
+    //! Return which lines of \a lines in [first_line, last_line) are shown, one bit per line
+    //! starting with the word containing \a first_line.
+    //!
+    //! Lines not matched yet against the patterns of the rules are matched on the fly, so this is
+    //! only meant for a few lines, e.g. the ones on screen while a job matches the whole log.
+    std::vector<std::uint64_t> shown_lines_in(
+        const line_store_t& lines,
+        std::size_t first_line,
+        std::size_t last_line) const;
+
+    //! Return the job matching the lines before \a last_line which have not been matched yet
+    //! against the patterns of the valid rules, whatever their behaviour.
+    match_job_t match_job(std::size_t last_line);
+
+    //! Run the \a job on \a lines, in tasks running on the global thread pool.
+    //!
+    //! Return \c false if the job has been cancelled by setting \a is_cancelled.
+    static bool
+    run(match_job_t& job, const line_store_t& lines, const std::atomic_bool& is_cancelled);
+
+    //! Keep the results of the \a job, for the lines before \a valid_line_count only.
+    //!
+    //! Lines starting at \a valid_line_count have changed since the job was created.
+    void merge(match_job_t job, std::size_t valid_line_count);
+
+private:
+    //! The lines matching a pattern, one bit per line.
+    struct matches_t
+    {
+        QRegularExpression pattern;
+        std::vector<std::uint64_t> words;
+
+        //! Number of lines, from the first one, which have been matched against the pattern.
+        std::size_t line_count = 0;
+    };
+
+    struct rule_t
+    {
+        QRegularExpression pattern;
+        filtering_behaviour_t behaviour;
+    };
+
+private:
+    matches_t& matches_for(const QRegularExpression& pattern);
+
+    //! Return the matches of the \a pattern, or nullptr if it has never been matched.
+    const matches_t* find_matches(const QRegularExpression& pattern) const;
+
+private:
+    //! The valid rules with a filtering behaviour, in order.
+    std::vector<rule_t> _rules;
+
+    //! The patterns of all the valid rules, whatever their behaviour, without duplicates.
+    std::vector<QRegularExpression> _patterns;
+
+    //! The matches of the patterns of all the valid rules, whatever their behaviour, so that they
+    //! are available when the behaviour of a rule changes. Rules without filtering behaviour are
+    //! matched as well, which costs one bit per line for each of them.
+    std::vector<matches_t> _matches;
+
+    bool _show_lines_by_default = true;
+    std::size_t _max_line_size = 0;
+};
+} // namespace flan
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <QByteArrayView>
+#include <QString>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace flan
+{
+//! A block of complete lines whose content is not owned by a line_store_t.
+//!
+//! This allows adding content to a line_store_t without copying it (e.g. lines from a memory
+//! mapped file).
+struct line_block_t
+{
+    //! Content of the lines, including the line terminators.
+    QByteArrayView data;
+
+    //! Offset in data of the end of each line, just after its line terminator (if any).
+    std::vector<std::uint32_t> line_ends;
+
+    //! Length of the longest line of the block in bytes.
+    std::size_t max_line_length = 0;
+
+    //! The owner of data, which is kept alive as long as the block is used.
+    std::shared_ptr<const void> owner;
+};
+
+using line_block_ptr_t = std::shared_ptr<const line_block_t>;
+
+//! Return the first \a max_size bytes of the UTF-8 \a line, without cutting a character in the
+//! middle. A \a max_size of 0 means no limit.
+QByteArrayView truncated_line(QByteArrayView line, std::size_t max_size);
+
+//! Storage for the lines of a log, which are mostly appended.
+//!
+//! Lines are kept as raw UTF-8 bytes packed one after the other in large chunks, along with the
+//! end offset of each line within its chunk. There is no per line object, so the cost of a line is
+//! its content plus 4 bytes of index, and any line can be accessed in O(log(chunk count)).
+//!
+//! The last line of the store may be incomplete (i.e. not terminated by a new line yet). Appending
+//! more text extends it until a new line is received. An incomplete empty line is not counted.
+//!
+//! Only the last chunk is ever modified, so the other ones are shared between a store and its
+//! snapshots. A snapshot can be read from another thread while the store is modified.
+//!
+//! The oldest lines can be removed to bound the memory used, a whole chunk at a time. Lines are
+//! indexed from the first line still in the store. The last lines can be removed as well, to
+//! replace them (e.g. when editing the content).
+class line_store_t
+{
+public:
+    //! Default capacity of a chunk in bytes.
+    static constexpr std::size_t default_chunk_capacity = 1024 * 1024;
+
+public:
+    explicit line_store_t(std::size_t chunk_capacity = default_chunk_capacity);
+
+    //! Append the UTF-8 encoded \a text at the end of the store.
+    //!
+    //! New lines in \a text terminate the current line. A "\r\n" sequence is handled as a single
+    //! line terminator.
+    void append(QByteArrayView text);
+
+    //! Append the \a text at the end of the store.
+    void append(const QString& text) { append(QByteArrayView{text.toUtf8()}); }
+
+    //! Append the lines of the \a block at the end of the store without copying them.
+    //!
+    //! If the last line of the store is incomplete, it is considered complete as the block can't
+    //! extend it.
+    void append(line_block_ptr_t block);
+
+    //! Remove all the lines from the store.
+    void clear();
+
+    //! Remove the lines starting at \a line, so that the last line left is complete.
+    //!
+    //! The chunk of \a line is copied rather than modified, as it might be shared with snapshots.
+    void truncate(std::size_t line);
+
+    //! Remove the oldest chunks until the store holds at most \a max_line_count lines and
+    //! \a max_byte_count bytes. A limit of 0 means no limit.
+    //!
+    //! The last chunk is never removed, so the store might still exceed the limits. Return the
+    //! number of lines removed.
+    std::size_t remove_oldest_lines(std::size_t max_line_count, std::size_t max_byte_count);
+
+    //! Return the number of lines removed by remove_oldest_lines() since the store was cleared.
+    std::size_t removed_line_count() const { return _removed_line_count; }
+
+    //! Return a copy of the store which is not affected by changes to this one.
+    //!
+    //! Only the last chunk is copied, if it is owned by the store.
+    line_store_t snapshot() const;
+
+    //! Return the number of lines in the store.
+    std::size_t line_count() const;
+
+    bool is_empty() const { return line_count() == 0; }
+
+    //! Return \c true if the last line has been terminated by a new line.
+    bool is_last_line_complete() const;
+
+    //! Return the UTF-8 content of the \a line, without the line terminator.
+    //!
+    //! \warning The returned view is invalidated by any change to the store.
+    QByteArrayView line_bytes(std::size_t line) const;
+
+    //! Return the content of the \a line, without the line terminator.
+    QString line(std::size_t line) const { return QString::fromUtf8(line_bytes(line)); }
+
+    //! Return the total size of the stored lines in bytes.
+    std::size_t byte_count() const { return _byte_count; }
+
+    //! Return the length of the longest line in bytes.
+    std::size_t max_line_length() const { return _max_line_length; }
+
+private:
+    struct chunk_t
+    {
+        //! Index of the first line of the chunk, counting the lines removed from the store.
+        std::size_t first_line = 0;
+
+        //! Content of the lines, including the line terminators, when owned by the store.
+        std::vector<char> data;
+
+        //! End offset in data of each complete line of the chunk, when owned by the store.
+        //!
+        //! The start offset of a line is the end offset of the previous one (or 0 for the first
+        //! line). Any data after the last end offset belongs to the incomplete last line.
+        std::vector<std::uint32_t> line_ends;
+
+        //! Content of the lines when not owned by the store. data and line_ends are unused then.
+        line_block_ptr_t block;
+
+        const char* bytes() const { return block ? block->data.data() : data.data(); }
+        std::size_t size() const { return block ? block->data.size() : data.size(); }
+
+        const std::vector<std::uint32_t>& ends() const
+        {
+            return block ? block->line_ends : line_ends;
+        }
+    };
+
+private:
+    const chunk_t& chunk_for_line(std::size_t line) const;
+    chunk_t& new_chunk();
+    void append_to_last_line(const char* data, std::size_t size);
+    void terminate_last_line();
+
+private:
+    std::size_t _chunk_capacity;
+    std::vector<std::shared_ptr<chunk_t>> _chunks;
+
+    //! Number of complete lines appended, including the ones removed since.
+    std::size_t _complete_line_count = 0;
+    std::size_t _removed_line_count = 0;
+    std::size_t _byte_count = 0;
+    std::size_t _max_line_length = 0;
+};
+} // namespace flan
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace flan
+{
+//! Which lines of a log are shown, as a bitset with one bit per line.
+//!
+//! The number of lines shown before each word of the bitset is kept along with it, so that the row
+//! of a line (i.e. its index among the lines shown) is computed in constant time, and the line at a
+//! row in logarithmic time. This costs about 2 bits per line, whether the line is shown or not.
+class line_visibility_t
+{
+public:
+    //! Return the number of lines whose visibility is known.
+    std::size_t line_count() const { return _line_count; }
+
+    //! Return the number of lines shown.
+    std::size_t shown_line_count() const { return _shown_line_count; }
+
+    bool is_shown(std::size_t line) const;
+
+    //! Return the number of lines shown before \a line.
+    //!
+    //! shown_line_count() is returned if \a line is not before line_count().
+    std::size_t rank(std::size_t line) const;
+
+    //! Return the line shown at index \a rank among the lines shown, which must be lower than
+    //! shown_line_count().
+    std::size_t select(std::size_t rank) const;
+
+    //! Append the lines up to \a last_line, excluded.
+    //!
+    //! The bits of \a words tell which lines are shown, starting with the word containing the line
+    //! at line_count(). Bits of the lines before line_count() or starting at \a last_line must be
+    //! cleared.
+    void append(const std::vector<std::uint64_t>& words, std::size_t last_line);
+
+    //! Replace the visibility of the lines in [first_line, last_line), before line_count().
+    //!
+    //! The bits of \a words tell which lines are shown, starting with the word containing
+    //! \a first_line. Bits of the lines out of the range are ignored.
+    void set_lines(
+        std::size_t first_line,
+        std::size_t last_line,
+        const std::vector<std::uint64_t>& words);
+
+    //! Forget the lines starting at \a line_count.
+    void truncate(std::size_t line_count);
+
+    //! Remove the \a line_count first lines. The following lines are then indexed from 0.
+    void remove_first_lines(std::size_t line_count);
+
+    void clear() { truncate(0); }
+
+private:
+    void update_ranks_from(std::size_t word_index);
+
+private:
+    std::vector<std::uint64_t> _words;
+
+    //! Number of lines shown before each word.
+    std::vector<std::size_t> _ranks;
+
+    std::size_t _line_count = 0;
+    std::size_t _shown_line_count = 0;
+};
+} // namespace flan
@@ -3,7 +3,6 @@
 
 #include <flan/timestamp_format.hpp>
 #include <QAction>
-#include <QTextBlock>
 #include <QWidget>
 
 namespace flan
@@ -22,30 +21,33 @@ public:
     QAction* use_relative_value_action() { return _use_relative_value_action; }
     QAction* use_timestamp_action() { return _use_timestamp_action; }
     QAction* timestamp_format_settings_action() { return _timestamp_format_settings_action; }
+    QAction* go_to_time_action() { return _go_to_time_action; }
 
     const timestamp_format_list_t& timestamp_formats() const { return _timestamp_formats; }
     void set_timestamp_formats(timestamp_format_list_t formats);
 
 protected:
     void paintEvent(QPaintEvent* event) override;
+    void changeEvent(QEvent* event) override;
 
 private:
     int ideal_width() const;
-    QString text_for_block(const QTextBlock& block);
+    QString text_for_line(std::size_t line);
     bool use_relative_value() const;
     bool use_timestamp() const;
-    QTime get_block_timestamp(const QTextBlock& block) const;
 
 private slots:
     void update_width();
-    void update_area(const QRect& rect, int dy);
+    void update_timestamp_formats();
     void show_timestamp_format_settings_dialog();
+    void go_to_time();
 
 private:
     log_widget_t* _log_widget = nullptr;
     QAction* _use_relative_value_action = nullptr;
     QAction* _use_timestamp_action = nullptr;
     QAction* _timestamp_format_settings_action = nullptr;
+    QAction* _go_to_time_action = nullptr;
 
     timestamp_format_list_t _timestamp_formats;
 };
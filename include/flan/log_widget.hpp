@@ -1,25 +1,88 @@
-
 #pragma once
 
+#include <flan/data_source.hpp>
+#include <flan/line_filter.hpp>
+#include <flan/line_store.hpp>
+#include <flan/line_visibility.hpp>
+#include <flan/rule_highlighter.hpp>
 #include <flan/styled_matching_rule.hpp>
-#include <QPlainTextEdit>
+#include <flan/timestamp_column.hpp>
+#include <QAbstractScrollArea>
+#include <QElapsedTimer>
+#include <QFuture>
 #include <QScrollBar>
+#include <QTextLayout>
+#include <QThreadPool>
+#include <QTimer>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 namespace flan
 {
-class rule_highlighter_t;
 class log_margin_area_widget_t;
 
-class log_widget_t : public QPlainTextEdit
+//! A position in the log, given as a line index and a column within this line.
+struct log_position_t
+{
+    std::size_t line = 0;
+    int column = 0;
+};
+
+inline bool operator==(const log_position_t& lhs, const log_position_t& rhs)
+{
+    return (lhs.line == rhs.line) && (lhs.column == rhs.column);
+}
+
+inline bool operator!=(const log_position_t& lhs, const log_position_t& rhs)
+{
+    return !(lhs == rhs);
+}
+
+inline bool operator<(const log_position_t& lhs, const log_position_t& rhs)
+{
+    return (lhs.line < rhs.line) || ((lhs.line == rhs.line) && (lhs.column < rhs.column));
+}
+
+//! Display a log and filter/highlight its lines according to a set of rules.
+//!
+//! The content of the log is kept in a line_store_t and only the lines currently on screen are laid
+//! out and painted. The lines shown (i.e. not filtered out by the rules) are called rows: the row
+//! index is the position of a line in the filtered view. Which lines are shown is kept in a
+//! line_visibility_t bitmap, so mapping rows to lines and back doesn't depend on the log size.
+//! Lines are matched against the filtering rules and their timestamp parsed by a job running in
+//! the background, so appending a large block of lines doesn't block the interface.
+//!
+//! Lines are only highlighted when they are about to be painted, and their highlighting is cached
+//! until the rules or the lines change. Lines are matched against the highlighting rules by worker
+//! threads, and are painted without highlighting until they are done. The layout of the lines is
+//! cached along with their highlighting, so repainting a line only draws its glyphs.
+//!
+//! Only the start of very long lines is shown, highlighted and filtered, so that a single huge line
+//! (e.g. binary data) doesn't freeze the log. Such a line is shown in full when double clicking its
+//! end.
+//!
+//! Lines wrapped at the width of the viewport take several lines of text on screen, but they are
+//! still a single row: the log scrolls by rows. The log can be made editable (e.g. for a scratch
+//! buffer), in which case an edit replaces the lines from the first one edited.
+class log_widget_t : public QAbstractScrollArea
 {
     Q_OBJECT
 
-    // The margin widget needs access to protected functions to work properly.
+    // The margin widget needs access to private functions to work properly.
     // Both the log widget and the margin widget are designed to work together and having a friend
     // avoids having to clutter the log widget API with seemingly random functions just to be able
     // to implement the margin widget.
     friend class log_margin_area_widget_t;
 
+public:
+    //! Default maximum size in bytes of the part of a line shown, highlighted and filtered.
+    static constexpr std::size_t default_max_line_size = 16 * 1024;
+
 public:
     log_widget_t(const QString& text, QWidget* parent = nullptr);
 
@@ -28,10 +91,79 @@ public:
     {
     }
 
+    ~log_widget_t() override;
+
     //! Return the selected content as plain text with the lines matching removing rules being
     //! excluded.
     QString plain_text_with_rules_applied() const;
 
+    //! Return the number of lines in the log, including the ones filtered out.
+    std::size_t line_count() const { return _lines.line_count(); }
+
+    //! Return the content of the \a line.
+    QString line_text(std::size_t line) const { return _lines.line(line); }
+
+    //! Return the number of lines removed from the start of the log by the retention policy.
+    //!
+    //! Lines are indexed from the first line still in the log, so this is the offset to add to
+    //! get the index of a line since the log was cleared.
+    std::size_t removed_line_count() const { return _lines.removed_line_count(); }
+
+    std::size_t max_line_size() const { return _max_line_size; }
+
+    bool is_editable() const { return _is_editable; }
+    bool is_wrapping_lines() const { return _is_wrapping_lines; }
+
+    //! Return the timestamp of the \a line, or no_timestamp if it has none.
+    timestamp_t timestamp(std::size_t line) const { return _timestamps.timestamp(line); }
+
+    //! Return the timestamp of the \a line like timestamp(), but parse the line right away if it
+    //! is still waiting for the background parsing.
+    timestamp_t parse_timestamp(std::size_t line) const;
+
+    //! Return the number of rows, i.e. the number of lines not filtered out.
+    int row_count() const { return static_cast<int>(_visibility.shown_line_count()); }
+
+    //! Return the line displayed at \a row.
+    std::size_t line_at_row(int row) const { return _visibility.select(row); }
+
+    //! Return the row of the \a line, or the row of the next line shown if \a line is filtered out.
+    //!
+    //! row_count() is returned if there is no line shown at or after \a line.
+    int row_for_line(std::size_t line) const { return static_cast<int>(_visibility.rank(line)); }
+
+    log_position_t cursor_position() const { return _cursor; }
+    log_position_t selection_start() const { return std::min(_anchor, _cursor); }
+    log_position_t selection_end() const { return std::max(_anchor, _cursor); }
+    bool has_selection() const { return _anchor != _cursor; }
+
+    //! Move the cursor to \a position.
+    //!
+    //! If \a keep_anchor is \c true, the content between the anchor and \a position is selected.
+    //! Otherwise the selection is cleared.
+    void set_cursor_position(log_position_t position, bool keep_anchor = false);
+
+    //! Select the content from \a anchor to \a position and scroll to make \a position visible.
+    void set_selection(log_position_t anchor, log_position_t position);
+
+    //! Result of go_to_timestamp()
+    enum class timestamp_search_t
+    {
+        //! The cursor is on the line with the timestamp.
+        found,
+
+        //! The line might be among the lines not filtered or parsed yet, so the cursor is on the
+        //! last line shown so far.
+        pending,
+
+        //! No line has the timestamp, the cursor is unchanged.
+        not_found,
+    };
+
+    //! Move the cursor to the first line whose timestamp is at or after \a timestamp, or to the
+    //! next line shown if it is filtered out, and scroll to make it visible.
+    timestamp_search_t go_to_timestamp(timestamp_t timestamp);
+
 public slots:
     void set_rules(flan::styled_matching_rule_list_t rules);
 
@@ -41,6 +173,40 @@ public slots:
     //! is not at the bottom. Otherwise, the log is scrolled to the bottom after the text is added.
     void append_text(const QString& text);
 
+    //! Append the lines of the \a block at the end of the log, without copying them.
+    //!
+    //! The scroll position is handled as in append_text(). Contrary to text, blocks are appended
+    //! even when the log is paused as they usually come from a static source (e.g. a file) which
+    //! would then be incomplete.
+    void append_line_block(flan::line_block_ptr_t block);
+
+    //! Replace the whole content of the log by \a text.
+    void set_text(const QString& text);
+
+    //! Remove the whole content of the log.
+    void clear();
+
+    //! Remove the oldest lines whenever the log exceeds the limits of the \a policy.
+    void set_retention_policy(flan::retention_policy_t policy);
+
+    //! Only show, highlight and filter the first \a max_line_size bytes of the lines, or whole
+    //! lines if 0.
+    //!
+    //! A line expanded by double clicking its end is still filtered on its first bytes.
+    void set_max_line_size(std::size_t max_line_size);
+
+    //! Find the timestamp of the lines with the \a formats, once for each line when it is appended.
+    //!
+    //! No line is parsed when there is no format.
+    void set_timestamp_formats(flan::timestamp_format_list_t formats);
+
+    //! Let the user edit the content of the log if \a is_editable is \c true.
+    void set_editable(bool is_editable);
+
+    //! Wrap the lines longer than the width of the viewport if \a is_wrapping_lines is \c true.
+    //! Otherwise they are scrolled horizontally.
+    void set_wrapping_lines(bool is_wrapping_lines);
+
     //! Pause appending text to the log is \a is_paused is \c true otherwise restart appending text.
     void set_paused(bool is_paused);
 
@@ -50,21 +216,308 @@ public slots:
     //! or removal.
     void set_show_lines_by_default(bool show_lines_by_default);
 
+    //! Copy the selected content to the clipboard. \sa plain_text_with_rules_applied().
+    void copy();
+
+    //! Insert the content of the clipboard at the cursor if the log is editable, otherwise append
+    //! it at the end of the log.
+    void paste();
+
+    void select_all();
+
+signals:
+    void line_count_changed(std::size_t line_count);
+    void cursor_position_changed();
+
+    //! Emitted every time the content displayed in the viewport might have changed (e.g. the log
+    //! has been scrolled, filtered or new lines have been added).
+    void viewport_updated();
+
+    void viewport_resized();
+
 protected:
+    void paintEvent(QPaintEvent* event) override;
+    void resizeEvent(QResizeEvent* event) override;
+    void scrollContentsBy(int dx, int dy) override;
+    void keyPressEvent(QKeyEvent* event) override;
+    void mousePressEvent(QMouseEvent* event) override;
     void mouseMoveEvent(QMouseEvent* event) override;
-    QMimeData* createMimeDataFromSelection() const override;
+    void mouseDoubleClickEvent(QMouseEvent* event) override;
+    void wheelEvent(QWheelEvent* event) override;
+    void inputMethodEvent(QInputMethodEvent* event) override;
+    void changeEvent(QEvent* event) override;
+
+private:
+    //! The highlighting of a line.
+    struct line_highlight_t
+    {
+        //! Length of the line.
+        int length = 0;
+
+        match_span_list_t spans;
+        QVector<QTextLayout::FormatRange> formats;
+
+        //! The line laid out with the formats, i.e. its glyphs ready to be drawn. Only computed
+        //! once the line is painted.
+        std::shared_ptr<QTextLayout> layout;
+
+        //! Only computed once the line is hovered.
+        std::optional<tooltip_index_t> tooltips;
+    };
+
+    //! A line matched by the highlighting workers.
+    struct highlighted_line_t
+    {
+        //! Index of the line since the log was cleared, as for _highlights.
+        std::size_t key = 0;
+        QString text;
+        match_span_list_t spans;
+    };
+
+    //! Matching and timestamp parsing of the lines, running in the background.
+    struct filtering_job_t
+    {
+        line_filter_t::match_job_t matching;
+        timestamp_column_t::parse_job_t parsing;
+
+        //! The current rows come from outdated matches (e.g. the rules changed), so all the rows
+        //! are computed again once the job is done. Otherwise only the lines without a row yet
+        //! get one.
+        bool are_rows_outdated = false;
+
+        bool is_empty() const { return matching.is_empty() && parsing.is_empty(); }
+
+        //! Return the largest number of lines handled by the matching or the parsing.
+        std::size_t line_count() const
+        {
+            std::size_t count = parsing.is_empty() ? 0 : parsing.last_line - parsing.first_line;
+            for (auto first_line: matching.first_lines)
+                count = std::max(count, matching.last_line - first_line);
+            return count;
+        }
+    };
+
+    enum class cursor_move_t
+    {
+        previous_char,
+        next_char,
+        start_of_line,
+        end_of_line,
+        previous_line,
+        next_line,
+        previous_page,
+        next_page,
+        start_of_log,
+        end_of_log,
+    };
 
 private:
+    int line_height() const;
+    int first_visible_row() const { return verticalScrollBar()->value(); }
+    int rows_per_page() const;
+
+    //! Return the height of the \a row, which is higher than line_height() if it is wrapped.
+    //!
+    //! The number of lines of text of wrapped lines is cached, so that walking the rows around
+    //! the viewport or at the end of the log doesn't lay out their lines every time.
+    int row_height(int row);
+
+    //! Return the number of rows fully visible from the first visible one, at least 1.
+    int visible_row_count();
+
+    //! Return the row at \a y in the viewport, and set \a row_top to the top of this row.
+    int row_at(int y, int& row_top);
+
+    void layout_line(QTextLayout& layout) const;
+
+    //! Return the layout of the \a line with its highlighting if it is cached, and cache the layout
+    //! along with it. Otherwise return the layout of the line without highlighting.
+    std::shared_ptr<QTextLayout> layout_for(std::size_t line);
+
+    //! Forget the cached layouts and numbers of lines of text, e.g. when the font or the width of
+    //! the viewport changes.
+    void forget_layouts();
+
+    //! Return the number of bytes shown from the start of the \a line, or 0 if it is shown in full.
+    std::size_t displayed_size(std::size_t line) const;
+
+    //! Return \c true if only the start of the \a line is shown.
+    bool is_truncated(std::size_t line) const;
+
+    //! Return the part of the \a line which is shown and highlighted.
+    QString displayed_text(std::size_t line) const;
+
+    //! Show the next max_line_size() bytes of the truncated \a line.
+    //!
+    //! A long line is expanded one chunk at a time, so that it is never laid out and highlighted
+    //! beyond what was asked for, even if it is megabytes long.
+    void expand_line(std::size_t line);
+
+    //! Return the layout of the \a line with the \a formats applied.
+    std::shared_ptr<QTextLayout>
+    make_layout(std::size_t line, const QVector<QTextLayout::FormatRange>& formats) const;
+    log_position_t position_at(QPoint point);
     QString tooltip_at(QPoint position);
+    void add_text(const QString& text);
+
+    //! Replace the content from \a start to \a end by \a text, and move the cursor after it.
+    void replace(log_position_t start, log_position_t end, const QString& text);
+
+    //! Edit the log according to the key \a event. Return \c false if the event is not an edit.
+    bool edit(QKeyEvent* event);
+
+    //! Change the size of the font by \a steps points.
+    void zoom(int steps);
+
+    //! Call \a append to add content to the store, then filter it and update the scroll position.
+    template <typename Append>
+    void append_to_store(Append append);
+
+    void move_cursor(cursor_move_t move, bool keep_anchor);
+    void ensure_cursor_visible();
+    void update_scrollbars();
+    void update_viewport();
+
+    //! Update the view after text has been appended: the scrollbars, the scroll position if the
+    //! log follows its end, and the viewport.
+    void update_frame();
+
+    //! Return the highlighting of the \a line, computing it if it is not cached yet.
+    line_highlight_t& highlight_for(std::size_t line);
+
+    //! Return the highlighting of the \a line if it is cached, nullptr otherwise.
+    line_highlight_t* find_highlight(std::size_t line);
+
+    //! Highlight the \a lines not cached yet in the background.
+    void request_highlights(const std::vector<std::size_t>& lines);
+
+    void start_highlighting(std::vector<highlighted_line_t> lines);
+    void finish_highlighting(std::vector<highlighted_line_t> lines);
+    void cancel_highlighting();
+
+    //! Highlight the lines around the viewport ahead of scrolling, and forget the highlighting of
+    //! the lines far from it.
+    void prefetch_highlights();
+
+    //! Forget the highlighting and the layout of the lines starting at \a first_line.
+    void forget_highlights_from(std::size_t first_line);
+
+    //! Remove the oldest lines if the log exceeds the limits of the retention policy, keeping the
+    //! same lines on screen if possible. Return the number of rows removed.
+    int remove_oldest_lines();
+
+    //! Compute the rows of the lines starting at \a first_line, for the lines already matched,
+    //! and match the other ones in the background.
+    void filter_lines_from(std::size_t first_line);
+
+    //! Match and parse the lines not handled yet in the background, unless a job is running
+    //! already, in which case they are handled once it is done.
+    void start_filtering();
+
+    void finish_filtering(filtering_job_t job);
+
+    //! Keep the results of the \a job, for the lines before \a valid_line_count only, and update
+    //! the rows.
+    void merge_filtering(filtering_job_t job, std::size_t valid_line_count);
+
+    void cancel_filtering();
+
+    //! Filter the lines from the top of the viewport with the current rules, while the rows are
+    //! outdated until the job in progress is done, so that the viewport shows the new filtering
+    //! right away. The rows of the other lines are left as is.
+    void preview_filtering();
 
 private slots:
 
+    //! Filter the whole log again after the rules changed.
+    //!
+    //! If lines have to be matched against new patterns, this happens in the background. Until it
+    //! is done, only the lines on screen are filtered with the new rules and the other rows are
+    //! kept. A new change to the rules cancels the filtering in progress.
     void apply_rules();
 
+    //! Filter the lines starting at \a first_line after they changed, keeping the state of the
+    //! previous lines.
+    //!
+    //! The lines are matched and their timestamp parsed in the background, so they only get a
+    //! row once this is done. Small changes (e.g. a few lines appended) are handled right away.
+    void apply_rules_from(std::size_t first_line);
+
 private:
+    line_store_t _lines;
+
+    //! Which lines are shown. A row is the index of a line among the lines shown.
+    line_visibility_t _visibility;
+
+    line_filter_t _filter;
+
+    timestamp_column_t _timestamps;
+
+    //! Single thread pool matching lines and parsing their timestamp in the background.
+    QThreadPool _filtering_thread_pool;
+    QFuture<void> _filtering;
+    std::shared_ptr<std::atomic_bool> _is_filtering_cancelled;
+    bool _is_filtering = false;
+
+    //! Incremented every time the background filtering starts or is cancelled, so that outdated
+    //! results are ignored.
+    std::size_t _filtering_generation = 0;
+
+    //! The first line changed while filtering in the background, whose results are outdated.
+    std::size_t _first_line_changed_while_filtering = 0;
+
+    //! Number of lines removed from the start of the log while filtering in the background.
+    std::size_t _line_count_removed_while_filtering = 0;
+
+    retention_policy_t _retention_policy;
+
+    std::size_t _max_line_size = default_max_line_size;
+
+    //! Number of bytes shown from the lines expanded beyond the maximum line size, indexed by line
+    //! since the log was cleared.
+    std::unordered_map<std::size_t, std::size_t> _expanded_line_sizes;
+
+    //! Update the view at most once per frame when text is appended.
+    QTimer _frame_timer;
+
+    //! Scroll to the end of the log on the next frame update.
+    bool _is_scroll_to_end_pending = false;
+
     rule_highlighter_t* _highlighter = nullptr;
+
+    //! Highlighting of the lines painted recently or about to be, indexed by line since the log
+    //! was cleared (i.e. counting the lines removed) so that it stays valid when lines are removed.
+    std::unordered_map<std::size_t, line_highlight_t> _highlights;
+
+    //! Number of lines of text of the wrapped lines, indexed as _highlights. It is kept for more
+    //! lines than the layouts, since it is only invalidated when the lines, the font, the width of
+    //! the viewport or the wrapping change.
+    std::unordered_map<std::size_t, int> _text_line_counts;
+
+    //! Prefetch the highlighting once the viewport has been painted.
+    QTimer _prefetch_highlights_timer;
+
+    //! Thread pool matching lines against the highlighting rules.
+    QThreadPool _highlighting_thread_pool;
+    std::shared_ptr<std::atomic_bool> _is_highlighting_cancelled;
+
+    //! Incremented every time the highlighting in progress is cancelled, so that outdated results
+    //! are ignored.
+    std::size_t _highlighting_generation = 0;
+
+    //! The lines being highlighted in the background, indexed as in _highlights.
+    std::unordered_set<std::size_t> _pending_highlights;
+
     styled_matching_rule_list_t _rules;
+    log_position_t _cursor;
+    log_position_t _anchor;
     bool _is_paused = false;
-    bool _show_lines_by_default = true;
+    bool _is_editable = false;
+    bool _is_wrapping_lines = true;
+
+    //! Time and position of the last double click, so that a click right after it selects the
+    //! whole line.
+    QElapsedTimer _double_click_timer;
+    QPoint _double_click_position;
 };
 } // namespace flan
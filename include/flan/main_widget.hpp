@@ -5,6 +5,8 @@
 #include <flan/matching_rule.hpp>
 #include <flan/style.hpp>
 #include <flan/timestamp_format.hpp>
+#include <QActionGroup>
+#include <QToolButton>
 #include <QWidget>
 
 namespace flan
@@ -17,6 +19,7 @@ class log_margin_area_widget_t;
 class find_widget_t;
 class data_source_t;
 class find_controller_t;
+class text_batcher_t;
 
 class main_widget_t : public QWidget
 {
@@ -30,6 +33,10 @@ public:
     const timestamp_format_list_t& timestamp_formats() const;
     void set_timestamp_formats(timestamp_format_list_t formats);
 
+    //! Maximum amount of bytes of the lines shown by the log, or 0 if there is no limit
+    std::size_t max_line_size() const;
+    void set_max_line_size(std::size_t max_line_size);
+
 public slots:
     void set_content(const QString& text);
     void set_model(flan::rule_model_t* model);
@@ -38,12 +45,18 @@ private slots:
     void on_current_data_source_changed(flan::data_source_t* data_source);
 
 private:
+    void add_max_line_size(const QString& text, std::size_t max_line_size);
+    void update_max_line_size();
+
     data_source_t* _current_data_source = nullptr;
+    text_batcher_t* _text_batcher = nullptr;
     data_source_selection_widget_t* _data_source = nullptr;
     rule_tree_widget_t* _rules = nullptr;
     log_widget_t* _log = nullptr;
     log_margin_area_widget_t* _log_margin = nullptr;
     find_controller_t* _find_controller = nullptr;
     find_widget_t* _find = nullptr;
+    QToolButton* _max_line_size_button = nullptr;
+    QActionGroup* _max_line_size_actions = nullptr;
 };
 } // namespace flan
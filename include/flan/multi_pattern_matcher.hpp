@@ -0,0 +1,65 @@
+#pragma once
+
+#include <QByteArrayView>
+#include <QRegularExpression>
+#include <cstdint>
+#include <vector>
+
+namespace flan
+{
+//! Find in a single scan of a text which patterns of a set might match it.
+//!
+//! The literals required by each pattern (see required_literals()) are searched all at once with
+//! an Aho-Corasick automaton. A pattern is a candidate if one of its literals is found, or if no
+//! literal could be extracted from it. Candidates still have to be confirmed by running the
+//! regular expression.
+class multi_pattern_matcher_t
+{
+public:
+    //! Set of candidate patterns, with one bit per pattern.
+    using candidates_t = std::vector<std::uint64_t>;
+
+    //! Maximum number of bytes of a literal searched by the automaton.
+    //!
+    //! Longer literals are truncated, which keeps the automaton small without rejecting any text
+    //! that might match as a prefix of a required literal is required as well.
+    static constexpr int max_literal_size = 16;
+
+public:
+    multi_pattern_matcher_t() = default;
+    explicit multi_pattern_matcher_t(const std::vector<QRegularExpression>& patterns);
+
+    std::size_t pattern_count() const { return _pattern_count; }
+
+    //! Set \a candidates to the patterns which might match the UTF-8 encoded \a text.
+    void find_candidates(QByteArrayView text, candidates_t& candidates) const;
+
+    candidates_t find_candidates(QByteArrayView text) const
+    {
+        candidates_t candidates;
+        find_candidates(text, candidates);
+        return candidates;
+    }
+
+    //! Return \c true if the \a pattern is among the \a candidates.
+    static bool is_candidate(const candidates_t& candidates, std::size_t pattern)
+    {
+        return (candidates[pattern / 64] >> (pattern % 64)) & 1;
+    }
+
+private:
+    static constexpr std::size_t alphabet_size = 256;
+
+private:
+    std::size_t _pattern_count = 0;
+
+    //! The patterns without required literals, which are always candidates.
+    candidates_t _always_candidates;
+
+    //! The next state for each state and byte, at index state * alphabet_size + byte.
+    std::vector<std::uint32_t> _transitions;
+
+    //! The patterns having a literal ending in each state.
+    std::vector<std::vector<std::uint32_t>> _outputs;
+};
+} // namespace flan
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <QRegularExpression>
+#include <QStringList>
+
+namespace flan
+{
+//! Return the literals of which at least one must appear in any text matching the \a pattern.
+//!
+//! There is one literal per top level alternative of the pattern. A text containing none of them
+//! can't match, which is much cheaper to check than running the regular expression.
+//!
+//! The extraction is conservative: when the pattern uses a construct the extraction doesn't
+//! understand, or a construct changing how literals match (e.g. case insensitivity), an empty list
+//! is returned, meaning that any text may match.
+QStringList required_literals(const QRegularExpression& pattern);
+} // namespace flan
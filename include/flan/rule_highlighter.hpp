@@ -1,25 +1,117 @@
-
 #pragma once
 
+#include <flan/multi_pattern_matcher.hpp>
 #include <flan/styled_matching_rule.hpp>
-#include <QSyntaxHighlighter>
+#include <QObject>
+#include <QTextLayout>
+#include <QTextCharFormat>
 #include <QVector>
+#include <cstdint>
+#include <memory>
+#include <vector>
 
 namespace flan
 {
-class rule_highlighter_t : public QSyntaxHighlighter
+//! A part of a line highlighted by a rule.
+struct match_span_t
+{
+    //! Index of the rule among the highlighting rules.
+    std::uint32_t rule = 0;
+
+    //! Index of the capture among the highlighted captures of the match, which selects the style.
+    std::uint32_t capture = 0;
+
+    int start = 0;
+    int length = 0;
+};
+
+//! The spans of a line, sorted by rule. The spans of a rule are in the order they were matched.
+using match_span_list_t = std::vector<match_span_t>;
+
+//! A part of a line whose tooltip is the one of a rule.
+struct tooltip_range_t
+{
+    int start = 0;
+    int end = 0;
+    std::uint32_t rule = 0;
+};
+
+//! The tooltip ranges of a line, which don't overlap and are sorted by start position.
+using tooltip_index_t = std::vector<tooltip_range_t>;
+
+//! Find the spans of the lines of a log for a set of highlighting rules.
+//!
+//! It is never modified once created, so it can be used from several threads at once.
+class span_matcher_t
+{
+public:
+    explicit span_matcher_t(std::vector<QRegularExpression> patterns = {});
+
+    //! Return the spans of \a text, which is a single line of the log.
+    match_span_list_t spans_for(const QString& text) const;
+
+    const std::vector<QRegularExpression>& patterns() const { return _patterns; }
+
+private:
+    std::vector<QRegularExpression> _patterns;
+
+    //! Matcher of the patterns, to skip the patterns which can't match a line.
+    multi_pattern_matcher_t _matcher;
+};
+
+//! Compute the formats to apply to a line of the log according to the highlighting rules.
+//!
+//! A line is matched once against the rules to find its spans, from which both its formats and its
+//! tooltips are computed.
+class rule_highlighter_t : public QObject
 {
     Q_OBJECT
 
 public:
-    rule_highlighter_t(QTextDocument* parent);
+    explicit rule_highlighter_t(QObject* parent = nullptr);
+
+    //! Set the \a rules used for highlighting. Rules without highlighting are ignored.
+    //!
+    //! Return \c true if the spans of the lines might have changed. Otherwise only the styles of
+    //! the rules changed, and formats can be computed again from the previous spans.
+    bool set_rules(styled_matching_rule_list_t rules);
+
+    //! Return the spans of \a text, which is a single line of the log.
+    match_span_list_t spans_for(const QString& text) const
+    {
+        return _span_matcher->spans_for(text);
+    }
 
-    void set_rules(styled_matching_rule_list_t rules);
+    //! Return the matcher of the current rules, to find spans from another thread.
+    std::shared_ptr<const span_matcher_t> span_matcher() const { return _span_matcher; }
 
-protected:
-    void highlightBlock(const QString& text) final;
+    //! Return the formats to apply to a line of \a length characters with the \a spans.
+    //!
+    //! The returned ranges don't overlap and are sorted by start position.
+    QVector<QTextLayout::FormatRange> formats_for(const match_span_list_t& spans, int length) const;
+
+    //! Return the tooltip ranges of a line with the \a spans, each range having the tooltip of the
+    //! first rule highlighting it.
+    tooltip_index_t tooltip_index_for(const match_span_list_t& spans) const;
+
+    //! Return the tooltip of the character at \a column according to the tooltip \a index of a
+    //! line, or an empty string if there is none.
+    QString tooltip_for(const tooltip_index_t& index, int column) const;
+
+private:
+    //! Return the index in _formats of the format for \a style, adding it if needed.
+    int format_index_for(const matching_style_t& style);
 
 private:
     styled_matching_rule_list_t _rules;
+
+    //! The distinct styles of the rules, resolved once into formats when the rules are set.
+    std::vector<matching_style_t> _styles;
+    std::vector<QTextCharFormat> _formats;
+
+    //! Index in _formats of each style of each rule, indexed like the rules and their styles.
+    std::vector<std::vector<int>> _rule_formats;
+
+    std::shared_ptr<const span_matcher_t> _span_matcher;
 };
 } // namespace flan
@@ -4,16 +4,29 @@
 #include <flan/rule_set.hpp>
 #include <flan/timestamp_format.hpp>
 #include <QString>
+#include <optional>
 
 namespace flan
 {
 QString get_default_settings_directory();
 QString get_default_settings_file_for_rules();
 QString get_default_settings_file_for_timestamp_formats();
+QString get_default_settings_file_for_options();
+
+//! Options of the application which are not part of the rules or the timestamp formats
+//!
+//! Options missing from the settings are left empty so the defaults apply.
+struct options_t
+{
+    std::optional<std::size_t> max_line_size;
+};
 
 void save_rules_to_json(const base_node_t& node, QString file_path);
 base_node_uniq_t load_rules_from_json(QString file_path);
 
 void save_timestamp_formats_to_json(const timestamp_format_list_t& formats, QString file_path);
 timestamp_format_list_t load_timestamp_formats_from_json(QString file_path);
+
+void save_options_to_json(const options_t& options, QString file_path);
+options_t load_options_from_json(QString file_path);
 } // namespace flan
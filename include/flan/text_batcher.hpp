@@ -0,0 +1,48 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QTimer>
+#include <chrono>
+
+namespace flan
+{
+//! Gather text received in small pieces into larger batches.
+//!
+//! Data sources might emit text line by line at a very high rate. Processing each piece separately
+//! (inserting it, filtering it, scrolling...) would be very expensive, so the text is accumulated
+//! and emitted at most once per interval, or as soon as the accumulated text reaches a maximum
+//! size.
+class text_batcher_t : public QObject
+{
+    Q_OBJECT
+
+public:
+    //! Interval between two batches, about one display frame.
+    static constexpr std::chrono::milliseconds interval{16};
+
+    //! Size of text (in characters) after which a batch is emitted without waiting.
+    static constexpr qsizetype max_size = 256 * 1024;
+
+public:
+    explicit text_batcher_t(QObject* parent = nullptr);
+
+public slots:
+    //! Add \a text to the current batch.
+    void add_text(const QString& text);
+
+    //! Emit the current batch now, if not empty.
+    void flush();
+
+    //! Drop the current batch without emitting it.
+    void discard();
+
+signals:
+    //! Emitted with the accumulated \a text when a batch is complete.
+    void text_ready(QString text);
+
+private:
+    QString _text;
+    QTimer _timer;
+};
+} // namespace flan
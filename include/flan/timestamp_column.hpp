@@ -0,0 +1,156 @@
+#pragma once
+
+#include <flan/line_store.hpp>
+#include <flan/timestamp_format.hpp>
+#include <flan/timestamp_parser.hpp>
+#include <atomic>
+#include <optional>
+#include <vector>
+
+namespace flan
+{
+//! The timestamp of each line of a log, according to a list of timestamp formats.
+//!
+//! Lines are parsed once, after they are appended to the log or when the formats change, and their
+//! timestamp is then only looked up. The timestamp of a line is the one found by the first format
+//! matching it. Parsing is done by jobs which can run in another thread while the column is used.
+//!
+//! The lines are grouped in zones of consecutive lines, and the latest timestamp of each zone is
+//! kept. Timestamps are usually increasing but not always (e.g. several sources merged in a single
+//! log), so this allows finding the first line at or after a point in time with a binary search
+//! over the zones followed by a scan of a few of them.
+class timestamp_column_t
+{
+public:
+    //! Number of lines parsed by a single task when parsing lines in parallel.
+    static constexpr std::size_t lines_per_task = 16 * 1024;
+
+    //! Number of lines in a zone.
+    static constexpr std::size_t lines_per_zone = 1024;
+
+    //! Parsing of the lines whose timestamp is not known yet.
+    //!
+    //! A job holds copies of everything it needs so that it can run in another thread while the
+    //! column is used, and its results are then merged into the column.
+    struct parse_job_t
+    {
+        timestamp_format_list_t formats;
+
+        //! Only the first bytes of the lines are parsed, see set_max_line_size().
+        std::size_t max_line_size = 0;
+
+        //! Lines are parsed from first_line up to last_line, excluded.
+        std::size_t first_line = 0;
+        std::size_t last_line = 0;
+
+        //! The timestamp of each line parsed, starting with first_line.
+        std::vector<timestamp_t> timestamps;
+
+        bool is_empty() const { return first_line >= last_line; }
+    };
+
+public:
+    const timestamp_format_list_t& formats() const { return _formats; }
+
+    //! Set the \a formats of the timestamps, which forgets the timestamps of all the lines.
+    //!
+    //! Lines are not parsed at all when there is no format.
+    void set_formats(timestamp_format_list_t formats);
+
+    //! Only parse the first \a max_line_size bytes of the lines, or whole lines if 0.
+    void set_max_line_size(std::size_t max_line_size);
+
+    //! Return the number of lines, from the first one, whose timestamp is known.
+    std::size_t line_count() const { return _timestamps.size(); }
+
+    //! Return \c true if some of the timestamps parsed have a date, i.e. are not on 1970-01-01.
+    //!
+    //! This is only reset when the timestamps of all the lines are forgotten.
+    bool has_dates() const { return _has_dates; }
+
+    //! Return the timestamp of the \a line, or no_timestamp if it has none or has not been parsed
+    //! yet.
+    timestamp_t timestamp(std::size_t line) const
+    {
+        return (line < _timestamps.size()) ? _timestamps[line] : no_timestamp;
+    }
+
+    //! Parse the \a line of \a lines with the current formats right away, whether its timestamp is
+    //! known or not. Return no_timestamp if it has none.
+    timestamp_t parse(const line_store_t& lines, std::size_t line) const
+    {
+        return parse_line(_formats, _max_line_size, lines, line);
+    }
+
+    //! Return the job parsing the lines before \a last_line whose timestamp is not known yet.
+    //!
+    //! The job is empty if there is no format.
+    parse_job_t parse_job(std::size_t last_line) const;
+
+    //! Run the \a job on \a lines, in tasks running on the global thread pool.
+    //!
+    //! Return \c false if the job has been cancelled by setting \a is_cancelled.
+    static bool
+    run(parse_job_t& job, const line_store_t& lines, const std::atomic_bool& is_cancelled);
+
+    //! Keep the results of the \a job, for the lines before \a valid_line_count only.
+    //!
+    //! Lines starting at \a valid_line_count have changed since the job was created. The formats
+    //! must not have changed.
+    void merge(parse_job_t job, std::size_t valid_line_count);
+
+    //! Return the first line whose timestamp is at or after \a timestamp, or line_count() if there
+    //! is none.
+    std::size_t first_line_at_or_after(timestamp_t timestamp) const;
+
+    //! Forget the timestamps of the lines starting at \a first_line, whose content has changed.
+    void forget_lines_from(std::size_t first_line);
+
+    //! Forget the timestamps of the \a line_count first lines, which have been removed from the
+    //! log. The following lines are then indexed from 0.
+    void remove_first_lines(std::size_t line_count);
+
+    //! Forget the results of the \a job for the \a line_count first lines, which have been removed
+    //! from the log while it was running.
+    static void remove_first_lines(parse_job_t& job, std::size_t line_count);
+
+private:
+    struct zone_t
+    {
+        //! Latest timestamp of the lines of the zone.
+        timestamp_t max = no_timestamp;
+
+        //! Latest timestamp of the lines of the zone and the previous ones, which never decreases.
+        //!
+        //! It might come from lines removed since, which only makes searches scan more lines.
+        timestamp_t max_so_far = no_timestamp;
+    };
+
+private:
+    //! Return the timestamp of the \a line of \a lines found by the first of the \a formats which
+    //! matches its first \a max_line_size bytes, or no_timestamp if none matches.
+    static timestamp_t parse_line(
+        const timestamp_format_list_t& formats,
+        std::size_t max_line_size,
+        const line_store_t& lines,
+        std::size_t line);
+
+    //! Return the index in _zones of the zone of \a line.
+    std::size_t zone_for(std::size_t line) const { return (line + _zone_offset) / lines_per_zone; }
+
+    //! Update the zones of the lines in [first_line, line_count()).
+    void update_zones_from(std::size_t first_line);
+
+private:
+    timestamp_format_list_t _formats;
+
+    std::size_t _max_line_size = 0;
+    std::vector<timestamp_t> _timestamps;
+    bool _has_dates = false;
+
+    std::vector<zone_t> _zones;
+
+    //! Number of lines of the first zone which have been removed.
+    std::size_t _zone_offset = 0;
+};
+} // namespace flan
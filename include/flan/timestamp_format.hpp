@@ -1,14 +1,80 @@
-
 #pragma once
 
 #include <QMetaType>
 #include <QRegularExpression>
 #include <QString>
-#include <QTime>
+#include <limits>
+#include <memory>
 #include <vector>
 
 namespace flan
 {
+//! A point in time in nanoseconds since 1970-01-01T00:00:00 UTC.
+//!
+//! Timestamps without a date are considered to be on 1970-01-01, so they are the number of
+//! nanoseconds since the start of the day.
+using timestamp_t = qint64;
+
+//! The timestamp of a line without any timestamp.
+constexpr timestamp_t no_timestamp = std::numeric_limits<timestamp_t>::min();
+
+constexpr timestamp_t nanoseconds_per_second = 1000 * 1000 * 1000;
+constexpr timestamp_t nanoseconds_per_day = 24 * 60 * 60 * nanoseconds_per_second;
+
+//! The components of a timestamp, as found in a line.
+//!
+//! Missing components are 0, or 1970-01-01 for the date. Components are not limited to their usual
+//! range, e.g. the seconds can be the number of seconds since the epoch.
+struct timestamp_fields_t
+{
+    qint64 year = 1970;
+    qint64 month = 1;
+    qint64 day = 1;
+    qint64 hour = 0;
+    qint64 minute = 0;
+    qint64 second = 0;
+    qint64 nanosecond = 0;
+
+    //! Offset of the local time from UTC in seconds, subtracted to get the UTC time.
+    qint64 utc_offset = 0;
+};
+
+//! Return the timestamp with the \a fields, or no_timestamp if the month or the day is out of
+//! range.
+timestamp_t timestamp_from(const timestamp_fields_t& fields);
+
+//! Return \a timestamp as an ISO 8601 date and time with microseconds, or only the time if it is
+//! on 1970-01-01.
+QString timestamp_to_string(timestamp_t timestamp);
+
+//! Return the \a duration in nanoseconds as hours, minutes, seconds and microseconds, preceded by
+//! the number of days if any.
+QString duration_to_string(qint64 duration);
+
+class timestamp_parser_t;
+
+//! A strftime-like spec of timestamps (see timestamp_parser_t) and its compiled parser.
+//!
+//! The spec is compiled once when set, and the parser is shared by the copies of the spec so
+//! that formats can be copied around, e.g. to parse lines in another thread, without compiling
+//! it again.
+class timestamp_spec_t
+{
+public:
+    timestamp_spec_t() = default;
+    timestamp_spec_t(const QString& text);
+
+    const QString& text() const { return _text; }
+    bool is_empty() const { return _text.isEmpty(); }
+
+    //! Return the parser of the spec, or nullptr if the spec is empty or invalid.
+    const timestamp_parser_t* parser() const { return _parser.get(); }
+
+private:
+    QString _text;
+    std::shared_ptr<const timestamp_parser_t> _parser;
+};
+
 struct timestamp_format_t
 {
     bool is_enabled = true;
@@ -17,20 +83,50 @@ struct timestamp_format_t
     int hour_index = -1;
     int minute_index = -1;
     int second_index = -1;
+
+    //! Index of a number of milliseconds, e.g. "5" is 5 milliseconds.
     int millisecond_index = -1;
 
-    QString match_hour(const QString& s) const;
-    QString match_minute(const QString& s) const;
-    QString match_second(const QString& s) const;
-    QString match_millisecond(const QString& s) const;
+    //! strftime-like spec of the timestamps (see timestamp_parser_t), used instead of the regular
+    //! expression and its captures when valid.
+    timestamp_spec_t spec;
 
-    QTime time_for(const QString& s) const;
+    int year_index = -1;
+    int month_index = -1;
+    int day_index = -1;
 
-private:
+    //! Index of the decimal fraction of the second, e.g. "5" is 500 milliseconds. Up to
+    //! nanoseconds are kept.
+    int fraction_index = -1;
+
+    //! Index of the offset of the time from UTC, e.g. "Z", "+02", "+0200" or "-02:00".
+    //!
+    //! The time is in UTC if nothing is captured. A line whose captured offset is invalid has no
+    //! timestamp.
+    int utc_offset_index = -1;
+
+    //! Return the text captured at \a index in \a s, or a null string if there is none.
     QString match_index(const QString& s, int index) const;
+
+    QString match_hour(const QString& s) const { return match_index(s, hour_index); }
+    QString match_minute(const QString& s) const { return match_index(s, minute_index); }
+    QString match_second(const QString& s) const { return match_index(s, second_index); }
+    QString match_millisecond(const QString& s) const
+    {
+        return match_index(s, millisecond_index);
+    }
+
+    //! Return the first timestamp in \a s, or no_timestamp if there is none.
+    timestamp_t timestamp_for(const QString& s) const;
 };
 
+//! Write the \a format to \a out, preceded by the version of the stream.
 QDataStream& operator<<(QDataStream& out, const timestamp_format_t& format);
+
+//! Read a \a format written by any version of operator<<(), including the ones without a version.
+//!
+//! The fields missing from older versions keep their default value. A stream written by a newer
+//! version is reported as corrupt data.
 QDataStream& operator>>(QDataStream& in, timestamp_format_t& format);
 
 using timestamp_format_list_t = std::vector<timestamp_format_t>;
@@ -55,10 +55,16 @@ private:
 
     QLineEdit* _name_lineedit;
     validated_lineedit_t* _pattern_lineedit;
+    validated_lineedit_t* _spec_lineedit;
     component_capture_widgets_t* _hour_widgets;
     component_capture_widgets_t* _minute_widgets;
     component_capture_widgets_t* _second_widgets;
     component_capture_widgets_t* _millisecond_widgets;
+    component_capture_widgets_t* _year_widgets;
+    component_capture_widgets_t* _month_widgets;
+    component_capture_widgets_t* _day_widgets;
+    component_capture_widgets_t* _fraction_widgets;
+    component_capture_widgets_t* _utc_offset_widgets;
 
     QLineEdit* _test_string_lineedit;
     QLabel* _preview_label;
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <flan/timestamp_format.hpp>
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QString>
+#include <vector>
+
+namespace flan
+{
+//! Find timestamps in lines according to a strftime-like spec, without regular expression.
+//!
+//! The spec is compiled once into a list of fields matched one after the other, each of them
+//! either a literal, a number or an offset from UTC. There is no backtracking: a match is attempted
+//! at each position of the line until one succeeds. The supported conversions are:
+//!
+//! - %Y: year, 4 digits
+//! - %m: month, 2 digits
+//! - %d: day of the month, 2 digits
+//! - %H: hour, 2 digits
+//! - %M: minute, 2 digits
+//! - %S: second, 2 digits
+//! - %f: fraction of second, 1 to 9 digits
+//! - %z: offset from UTC, see read_utc_offset()
+//! - %s: number of seconds since the epoch, 1 to 12 digits
+//! - %%: a literal %
+//!
+//! A timestamp is never found in the middle of a number, i.e. right after or before a digit.
+class timestamp_parser_t
+{
+public:
+    //! Compile the \a spec. The parser is invalid if the spec is empty or has an unknown
+    //! conversion.
+    explicit timestamp_parser_t(const QString& spec = {});
+
+    bool is_valid() const { return !_fields.empty(); }
+
+    //! Return the first timestamp in the UTF-8 encoded \a line, or no_timestamp if there is none.
+    timestamp_t timestamp_for(QByteArrayView line) const;
+
+    //! Return the timestamp in the UTF-8 encoded \a text if the whole text matches the spec, or
+    //! no_timestamp otherwise.
+    timestamp_t exact_timestamp_for(QByteArrayView text) const;
+
+private:
+    enum class field_kind_t
+    {
+        literal,
+        year,
+        month,
+        day,
+        hour,
+        minute,
+        second,
+        fraction,
+        utc_offset,
+        epoch,
+    };
+
+    struct field_t
+    {
+        field_kind_t kind = field_kind_t::literal;
+
+        //! The bytes of a literal field.
+        QByteArray literal;
+    };
+
+private:
+    //! Return the timestamp starting at \a start in \a line, or no_timestamp if there is none.
+    //!
+    //! \a end is set to the position following the timestamp if there is one.
+    timestamp_t timestamp_at(QByteArrayView line, qsizetype start, qsizetype& end) const;
+
+private:
+    std::vector<field_t> _fields;
+};
+
+//! Read the offset from UTC at the start of \a text into \a offset, in seconds.
+//!
+//! The offset is either "Z" or a sign followed by 2 digits of hours and optionally 2 digits of
+//! minutes, separated or not by a colon (e.g. "+02", "+0200" or "-02:00"). Return the number of
+//! bytes read, or 0 if \a text doesn't start with an offset.
+int read_utc_offset(QByteArrayView text, qint64& offset);
+} // namespace flan
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <flan/timestamp_parser.hpp>
+#include <QValidator>
+
+namespace flan
+{
+//! Accept empty specs, which are not used, and the specs timestamp_parser_t can compile.
+class valid_timestamp_spec_validator_t : public QValidator
+{
+    Q_OBJECT
+
+public:
+    valid_timestamp_spec_validator_t(QObject* parent = nullptr)
+        : QValidator{parent}
+    {
+    }
+
+    inline State validate(QString& input, int&) const final
+    {
+        return (input.isEmpty() || timestamp_parser_t{input}.is_valid()) ? State::Acceptable
+                                                                         : State::Intermediate;
+    }
+};
+} // namespace flan
@@ -7,4 +7,18 @@ data_source_t::data_source_t(QObject* parent)
     : QObject{parent}
 {
 }
+
+std::vector<line_block_ptr_t> data_source_t::line_blocks() const
+{
+    return {};
+}
+
+void data_source_t::set_retention_policy(retention_policy_t policy)
+{
+    if (_retention_policy == policy)
+        return;
+
+    _retention_policy = policy;
+    emit retention_policy_changed(_retention_policy);
+}
 } // namespace flan
@@ -0,0 +1,53 @@
+
+#include <flan/data_source_delegate_file.hpp>
+#include <flan/data_source_file.hpp>
+#include <flan/elided_label.hpp>
+#include <QFileDialog>
+#include <QFileInfo>
+#include <QHBoxLayout>
+#include <QPushButton>
+
+namespace flan
+{
+data_source_delegate_file_t::data_source_delegate_file_t(
+    data_source_file_t& data_source,
+    QObject* parent)
+    : data_source_delegate_t{data_source, parent}
+    , _data_source_file{data_source}
+{
+}
+
+QWidget* data_source_delegate_file_t::create_view(QWidget* parent) const
+{
+    auto open_button = new QPushButton{tr("Open...")};
+    auto file_label = new elided_label_t;
+
+    auto layout = new QHBoxLayout;
+    layout->setContentsMargins(0, 0, 0, 0);
+    layout->addWidget(open_button);
+    layout->addWidget(file_label, 1);
+
+    auto main_widget = new QWidget{parent};
+    main_widget->setLayout(layout);
+
+    connect(open_button, &QPushButton::clicked, this, [this, open_button]() {
+        const auto file_path = QFileDialog::getOpenFileName(
+            open_button, tr("Open a log file"), QFileInfo{_data_source_file.file_path()}.path());
+        if (!file_path.isEmpty())
+            _data_source_file.open(file_path);
+    });
+
+    auto update_file_label = [file_label](const QString& file_path) {
+        file_label->set_text(QFileInfo{file_path}.fileName());
+        file_label->setToolTip(file_path);
+    };
+    connect(
+        &_data_source_file,
+        &data_source_file_t::file_path_changed,
+        file_label,
+        update_file_label);
+    update_file_label(_data_source_file.file_path());
+
+    return main_widget;
+}
+} // namespace flan
@@ -0,0 +1,19 @@
+
+#include <flan/data_source_delegate_file.hpp>
+#include <flan/data_source_delegate_provider_file.hpp>
+#include <flan/data_source_file.hpp>
+
+namespace flan
+{
+data_source_delegate_provider_file_t::data_source_delegate_provider_file_t(QObject* parent)
+    : data_source_delegate_provider_t{parent}
+    , _source{new data_source_file_t{this}}
+    , _delegate{new data_source_delegate_file_t{*_source, this}}
+{
+}
+
+std::vector<data_source_delegate_t*> data_source_delegate_provider_file_t::delegates() const
+{
+    return {_delegate};
+}
+} // namespace flan
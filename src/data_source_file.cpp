@@ -0,0 +1,163 @@
+
+#include <flan/data_source_file.hpp>
+#include <QFile>
+#include <QThread>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+namespace flan
+{
+namespace
+{
+//! Size of the first block of lines, kept small so that it is indexed and shown immediately.
+constexpr std::size_t first_block_size = 256 * 1024;
+
+//! Size of the following blocks of lines.
+constexpr std::size_t block_size = 32 * 1024 * 1024;
+
+//! Line ends are stored as 32 bits offsets so a block can't be larger than that.
+constexpr std::size_t max_block_size = std::numeric_limits<std::uint32_t>::max();
+
+//! Return the end of the block of about \a size bytes starting at \a begin.
+//!
+//! The block ends just after a new line so that a line never spans several blocks. A line larger
+//! than \a size makes the block larger, up to max_block_size where the line is split.
+const char* find_block_end(const char* begin, const char* end, std::size_t size)
+{
+    if (static_cast<std::size_t>(end - begin) <= size)
+        return end;
+
+    const char* limit = begin + size;
+    for (const char* it = limit; it != begin; --it)
+    {
+        if (it[-1] == '\n')
+            return it;
+    }
+
+    const char* max_end = begin + std::min(static_cast<std::size_t>(end - begin), max_block_size);
+    auto new_line = static_cast<const char*>(std::memchr(limit, '\n', max_end - limit));
+    return new_line ? new_line + 1 : max_end;
+}
+
+line_block_ptr_t
+make_line_block(const char* begin, const char* end, std::shared_ptr<const void> owner)
+{
+    auto block = std::make_shared<line_block_t>();
+    block->data = QByteArrayView{begin, end};
+    block->owner = std::move(owner);
+
+    const char* line_start = begin;
+    while (line_start != end)
+    {
+        auto new_line = static_cast<const char*>(std::memchr(line_start, '\n', end - line_start));
+        const char* line_end = new_line ? new_line + 1 : end;
+
+        block->line_ends.push_back(static_cast<std::uint32_t>(line_end - begin));
+        block->max_line_length =
+            std::max(block->max_line_length, static_cast<std::size_t>(line_end - line_start));
+        line_start = line_end;
+    }
+
+    return block;
+}
+} // namespace
+
+data_source_file_t::data_source_file_t(QObject* parent)
+    : data_source_t{parent}
+{
+}
+
+data_source_file_t::~data_source_file_t()
+{
+    close();
+}
+
+void data_source_file_t::open(const QString& file_path)
+{
+    close();
+
+    _file_path = file_path;
+    emit file_path_changed(_file_path);
+    emit content_reset();
+
+    auto file = std::make_shared<QFile>(file_path);
+    if (!file->open(QIODevice::ReadOnly))
+    {
+        set_error_message(file->errorString());
+        return;
+    }
+
+    set_error_message({});
+    if (file->size() == 0)
+        return;
+
+    // The mapping stays valid as long as the file is open, which is as long as any block
+    // referencing it is alive.
+    const auto data = reinterpret_cast<const char*>(file->map(0, file->size()));
+    if (!data)
+    {
+        set_error_message(file->errorString());
+        return;
+    }
+
+    const auto size = static_cast<std::size_t>(file->size());
+    const auto generation = _generation;
+
+    _stop_indexing = false;
+    _indexing_thread = QThread::create([this, file, data, size, generation]() {
+        const char* begin = data;
+        const char* end = data + size;
+        std::size_t current_block_size = first_block_size;
+
+        while ((begin != end) && !_stop_indexing)
+        {
+            const char* block_end = find_block_end(begin, end, current_block_size);
+            auto block = make_line_block(begin, block_end, file);
+
+            // Blocks are handed over to the thread of the data source, where they are dropped if
+            // the file has been closed in the meantime.
+            QMetaObject::invokeMethod(
+                this,
+                [this, block, generation]() {
+                    if (generation == _generation)
+                        add_line_block(block);
+                },
+                Qt::QueuedConnection);
+
+            begin = block_end;
+            current_block_size = block_size;
+        }
+    });
+    _indexing_thread->start();
+}
+
+void data_source_file_t::close()
+{
+    if (_indexing_thread)
+    {
+        _stop_indexing = true;
+        _indexing_thread->wait();
+        delete _indexing_thread;
+        _indexing_thread = nullptr;
+    }
+
+    ++_generation;
+    _line_blocks.clear();
+}
+
+void data_source_file_t::add_line_block(line_block_ptr_t block)
+{
+    _line_blocks.push_back(block);
+    emit new_line_block(std::move(block));
+}
+
+void data_source_file_t::set_error_message(QString error_message)
+{
+    if (_error_message != error_message)
+    {
+        _error_message = std::move(error_message);
+        emit error_changed(_error_message);
+    }
+}
+} // namespace flan
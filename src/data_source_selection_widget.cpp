@@ -4,18 +4,23 @@
 #include <flan/data_source_selection_widget.hpp>
 #include <flan/elided_label.hpp>
 #include <QAction>
+#include <QLocale>
+#include <QMenu>
 
 namespace flan
 {
 data_source_selection_widget_t::data_source_selection_widget_t(QWidget* parent)
     : QWidget{parent}
     , _data_source_combobox{new QComboBox}
+    , _retention_policy_button{new QToolButton}
+    , _retention_policy_actions{new QActionGroup{this}}
     , _current_source_widget_layout{new QHBoxLayout}
     , _error_label{new elided_label_t}
 {
     auto main_layout = new QHBoxLayout;
     main_layout->setContentsMargins(0, 0, 0, 0);
     main_layout->addWidget(_data_source_combobox);
+    main_layout->addWidget(_retention_policy_button);
     main_layout->addLayout(_current_source_widget_layout);
     main_layout->addWidget(_error_label);
     main_layout->addStretch();
@@ -36,6 +41,26 @@ data_source_selection_widget_t::data_source_selection_widget_t(QWidget* parent)
         this,
         &data_source_selection_widget_t::rebuild_custom_widgets);
 
+    // The oldest lines of the log are removed beyond the retention policy of the data source.
+    _retention_policy_button->setText(tr("Keep"));
+    _retention_policy_button->setToolTip(tr("Amount of lines kept from the data source"));
+    _retention_policy_button->setPopupMode(QToolButton::InstantPopup);
+    _retention_policy_button->setMenu(new QMenu{_retention_policy_button});
+    _retention_policy_actions->setExclusionPolicy(QActionGroup::ExclusionPolicy::ExclusiveOptional);
+
+    const QLocale locale;
+    add_retention_policy(tr("Keep all lines"), {});
+    for (std::size_t line_count: {100'000, 1'000'000, 10'000'000})
+        add_retention_policy(tr("Keep the last %L1 lines").arg(line_count), {line_count, 0});
+    for (std::size_t byte_count: {64, 256, 1024})
+    {
+        byte_count *= 1024 * 1024;
+        add_retention_policy(
+            tr("Keep the last %1").arg(locale.formattedDataSize(
+                static_cast<qint64>(byte_count), 0, QLocale::DataSizeTraditionalFormat)),
+            {0, byte_count});
+    }
+
     set_data_sources({});
 }
 
@@ -60,6 +85,11 @@ void data_source_selection_widget_t::set_data_sources(data_source_delegate_list_
             &data_source_t::error_changed,
             this,
             &data_source_selection_widget_t::update_error);
+        connect(
+            &data_source,
+            &data_source_t::retention_policy_changed,
+            this,
+            &data_source_selection_widget_t::update_retention_policy);
     }
 
     if (_delegates.empty())
@@ -74,6 +104,22 @@ void data_source_selection_widget_t::set_data_sources(data_source_delegate_list_
     }
 }
 
+void data_source_selection_widget_t::add_retention_policy(
+    const QString& text,
+    retention_policy_t policy)
+{
+    auto action = _retention_policy_button->menu()->addAction(text);
+    action->setCheckable(true);
+    action->setData(static_cast<int>(_retention_policies.size()));
+    _retention_policy_actions->addAction(action);
+    _retention_policies.push_back(policy);
+
+    connect(action, &QAction::triggered, this, [this, policy]() {
+        if (auto delegate = current_delegate())
+            delegate->data_source().set_retention_policy(policy);
+    });
+}
+
 data_source_delegate_t* data_source_selection_widget_t::current_delegate() const
 {
     if (_data_source_combobox->currentIndex() < _delegates.size())
@@ -102,6 +148,7 @@ void data_source_selection_widget_t::rebuild_custom_widgets()
     }
 
     update_error();
+    update_retention_policy();
     emit current_data_source_changed(current_data_source);
 }
 
@@ -120,4 +167,16 @@ void data_source_selection_widget_t::update_error()
     _error_label->setToolTip(error_text);
     _error_label->setVisible(!error_text.isEmpty());
 }
+
+void data_source_selection_widget_t::update_retention_policy()
+{
+    auto delegate = current_delegate();
+    _retention_policy_button->setEnabled(delegate != nullptr);
+
+    // A policy set by the data source itself might not be one of the choices.
+    const auto policy =
+        delegate ? delegate->data_source().retention_policy() : retention_policy_t{};
+    for (auto action: _retention_policy_actions->actions())
+        action->setChecked(_retention_policies[action->data().toInt()] == policy);
+}
 } // namespace flan
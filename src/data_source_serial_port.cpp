@@ -63,6 +63,7 @@ data_source_serial_port_t::data_source_serial_port_t(QSerialPortInfo info, QObje
     });
 
     set_settings(_settings);
+    set_retention_policy(retention_policy_t::streaming_default());
 }
 
 void data_source_serial_port_t::open()
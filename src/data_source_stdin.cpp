@@ -9,5 +9,6 @@ data_source_stdin_t::data_source_stdin_t(QObject* parent)
     , _notifier{new stdin_socket_notifier_t{this}}
 {
     connect(_notifier, &stdin_socket_notifier_t::new_line, this, &data_source_stdin_t::new_text);
+    set_retention_policy(retention_policy_t::streaming_default());
 }
 } // namespace flan
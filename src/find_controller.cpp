@@ -1,14 +1,14 @@
 
 #include <flan/find_controller.hpp>
+#include <flan/log_widget.hpp>
 #include <QRegularExpression>
-#include <QTextBlock>
-#include <QTextCursor>
+#include <utility>
 
 namespace flan
 {
-find_controller_t::find_controller_t(QPlainTextEdit* text_edit, QObject* parent)
+find_controller_t::find_controller_t(log_widget_t* log_widget, QObject* parent)
     : QObject{parent}
-    , _text_edit{text_edit}
+    , _log_widget{log_widget}
     , _find_action{new QAction{tr("Find"), this}}
     , _next_action{new QAction{tr("Next")}}
     , _previous_action{new QAction{tr("Previous")}}
@@ -17,7 +17,7 @@ find_controller_t::find_controller_t(QPlainTextEdit* text_edit, QObject* parent)
 {
     _find_action->setShortcut(QKeySequence::Find);
     connect(_find_action, &QAction::triggered, this, [this]() {
-        set_pattern(_text_edit->textCursor().selectedText());
+        set_pattern(_log_widget->plain_text_with_rules_applied());
     });
 
     _next_action->setShortcut(QKeySequence::FindNext);
@@ -56,10 +56,7 @@ void find_controller_t::set_pattern(QString pattern)
         // This can't be done in the find() function as otherwise search for the next match using
         // the same pattern (e.g. when click a "next" button) would always lead in the same match
         // being selected.
-        auto start_of_search_cursor = _text_edit->textCursor();
-        start_of_search_cursor.setPosition(
-            start_of_search_cursor.selectionStart(), QTextCursor::MoveAnchor);
-        _text_edit->setTextCursor(start_of_search_cursor);
+        _log_widget->set_cursor_position(_log_widget->selection_start());
 
         find(new_pattern_ends_with_old_pattern ? true : false);
     }
@@ -77,79 +74,114 @@ bool find_controller_t::use_regexp() const
 
 void find_controller_t::find(bool search_backward)
 {
-    const auto original_cursor = _text_edit->textCursor();
-    bool found = false;
+    const int row_count = _log_widget->row_count();
+    if (_pattern.isEmpty() || (row_count == 0))
+        return;
 
-    QTextDocument::FindFlags flags{};
-    if (is_case_sensitive())
-        flags |= QTextDocument::FindCaseSensitively;
-    if (search_backward)
-        flags |= QTextDocument::FindBackward;
+    const auto case_sensitivity = is_case_sensitive() ? Qt::CaseSensitive : Qt::CaseInsensitive;
 
+    QRegularExpression regexp;
     if (use_regexp())
     {
         QRegularExpression::PatternOptions options{};
-
-        // find with regexp ignores FindCaseSensitively so use the regexp option instead.
         if (!is_case_sensitive())
             options |= QRegularExpression::CaseInsensitiveOption;
-        QRegularExpression regexp{_pattern, options};
 
-        // find with regexp only searches in the current block. This means if no match is found we
-        // need to iterate over each block until either a match is found, or we looped back to the
-        // starting cursor position.
-        do
+        regexp = QRegularExpression{_pattern, options};
+        if (!regexp.isValid())
+            return;
+    }
+
+    // Return the start and length of the first match in the text starting at or after the \a from
+    // position. The start is -1 if there is no match. Empty matches are ignored.
+    auto find_forward = [&](const QString& text, int from) -> std::pair<int, int> {
+        if (use_regexp())
         {
-            found = _text_edit->find(regexp, flags);
-            if (!found || _text_edit->textCursor().selectedText().isEmpty())
+            auto it = regexp.globalMatch(text, from);
+            while (it.hasNext())
             {
-                found = false;
-                if (search_backward)
+                auto match = it.next();
+                if (match.capturedLength() > 0)
                 {
-                    // Move to the start of the block to ensure next find() call will search in the
-                    // previous block.
-                    _text_edit->moveCursor(QTextCursor::StartOfBlock);
-
-                    // Start over from the end if we reached the start of the document.
-                    if (_text_edit->textCursor().atStart())
-                        _text_edit->moveCursor(QTextCursor::End);
+                    return {
+                        static_cast<int>(match.capturedStart()),
+                        static_cast<int>(match.capturedLength())};
                 }
-                else
-                {
-                    // Move first to the end of the current block to ensure that if there is no next
-                    // block, the atEnd() checks succeeds and we loop over.
-                    _text_edit->moveCursor(QTextCursor::EndOfBlock);
+            }
 
-                    // Move to the next block (in any) to ensure next find() call will search in the
-                    // next block.
-                    _text_edit->moveCursor(QTextCursor::NextBlock);
+            return {-1, 0};
+        }
+
+        return {
+            static_cast<int>(text.indexOf(_pattern, from, case_sensitivity)),
+            static_cast<int>(_pattern.size())};
+    };
+
+    // Return the start and length of the last match in the text starting before the \a before
+    // position. The start is -1 if there is no match. Empty matches are ignored.
+    auto find_backward = [&](const QString& text, int before) -> std::pair<int, int> {
+        if (before <= 0)
+            return {-1, 0};
+
+        if (use_regexp())
+        {
+            std::pair<int, int> last_match{-1, 0};
+            auto it = regexp.globalMatch(text);
+            while (it.hasNext())
+            {
+                auto match = it.next();
+                if (match.capturedStart() >= before)
+                    break;
 
-                    // Start over from the start if we reached the end of the document.
-                    if (_text_edit->textCursor().atEnd())
-                        _text_edit->moveCursor(QTextCursor::Start);
+                if (match.capturedLength() > 0)
+                {
+                    last_match = {
+                        static_cast<int>(match.capturedStart()),
+                        static_cast<int>(match.capturedLength())};
                 }
             }
-        } while (!found && (_text_edit->textCursor().block() != original_cursor.block()));
-    }
-    else
+
+            return last_match;
+        }
+
+        return {
+            static_cast<int>(text.lastIndexOf(_pattern, before - 1, case_sensitivity)),
+            static_cast<int>(_pattern.size())};
+    };
+
+    // Search from the end of the selection when searching forward and from its start when
+    // searching backward, so that the current match is not found again.
+    const auto reference =
+        search_backward ? _log_widget->selection_start() : _log_widget->selection_end();
+
+    // If the reference line is filtered out, the row found is the one of the next line shown.
+    int row = _log_widget->row_for_line(reference.line);
+    const bool is_on_reference_line =
+        (row < row_count) && (_log_widget->line_at_row(row) == reference.line);
+    if (search_backward && !is_on_reference_line)
+        --row;
+    row = (row + row_count) % row_count;
+
+    // Search in each row, looping back at the end (or start) of the log, until the row we started
+    // from is searched again, this time in full.
+    for (int i = 0; i <= row_count; ++i)
     {
-        // find with no regexp already searches in all blocks. We just need to handle loop back when
-        // the start/end of the document is reached.
-        found = _text_edit->find(_pattern, flags);
-        if (!found)
-        {
-            // If the search failed from the current position, try again from the beginning/end.
-            if (search_backward)
-                _text_edit->moveCursor(QTextCursor::End);
-            else
-                _text_edit->moveCursor(QTextCursor::Start);
+        const std::size_t line = _log_widget->line_at_row(row);
+        const QString text = _log_widget->line_text(line);
+        const bool use_reference_column = (i == 0) && is_on_reference_line;
+        const int end_of_line = static_cast<int>(text.size());
+
+        const auto [start, length] = search_backward ?
+            find_backward(text, use_reference_column ? reference.column : end_of_line + 1) :
+            find_forward(text, use_reference_column ? reference.column : 0);
 
-            found = _text_edit->find(_pattern, flags);
+        if (start >= 0)
+        {
+            _log_widget->set_selection({line, start}, {line, start + length});
+            return;
         }
-    }
 
-    // Restore the original cursor position if no match.
-    if (!found)
-        _text_edit->setTextCursor(original_cursor);
+        row = search_backward ? (row - 1 + row_count) % row_count : (row + 1) % row_count;
+    }
 }
 } // namespace flan
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace flan
+{
+// Helpers for bitsets with one bit per line of a log, stored in 64 bit words.
+
+constexpr std::size_t bits_per_word = 64;
+
+inline std::size_t word_count_for(std::size_t line_count)
+{
+    return (line_count + bits_per_word - 1) / bits_per_word;
+}
+
+//! Return a word with the bits of the lines in [first_line, last_line) set, for the word
+//! containing the line at \a word_index * bits_per_word.
+inline std::uint64_t
+mask_for(std::size_t word_index, std::size_t first_line, std::size_t last_line)
+{
+    const std::size_t word_first_line = word_index * bits_per_word;
+    const std::size_t begin = std::max(first_line, word_first_line) - word_first_line;
+    const std::size_t end = std::min(last_line, word_first_line + bits_per_word) - word_first_line;
+
+    const std::uint64_t below_end = (end == bits_per_word) ? ~std::uint64_t{0}
+                                                           : ((std::uint64_t{1} << end) - 1);
+    const std::uint64_t below_begin = (std::uint64_t{1} << begin) - 1;
+    return below_end & ~below_begin;
+}
+
+//! Remove the bits of the \a line_count first lines from \a words, moving the following ones to
+//! the front, and keep the words needed for \a new_line_count lines.
+inline void remove_first_bits(
+    std::vector<std::uint64_t>& words,
+    std::size_t line_count,
+    std::size_t new_line_count)
+{
+    words.erase(words.begin(), words.begin() + std::min(line_count / bits_per_word, words.size()));
+
+    const std::size_t shift = line_count % bits_per_word;
+    if ((shift != 0) && !words.empty())
+    {
+        for (std::size_t word_index = 0; word_index + 1 < words.size(); ++word_index)
+            words[word_index] =
+                (words[word_index] >> shift) | (words[word_index + 1] << (bits_per_word - shift));
+        words.back() >>= shift;
+    }
+
+    words.resize(word_count_for(new_line_count), 0);
+}
+} // namespace flan
@@ -0,0 +1,346 @@
+#include "line_bits.hpp"
+#include <flan/line_filter.hpp>
+#include <QtConcurrent/QtConcurrentMap>
+#include <algorithm>
+#include <cassert>
+#include <limits>
+#include <optional>
+
+namespace flan
+{
+static_assert(
+    line_filter_t::lines_per_task % bits_per_word == 0,
+    "Tasks must not share words so that they can run in parallel");
+
+bool line_filter_t::set_rules(const styled_matching_rule_list_t& rules)
+{
+    std::vector<rule_t> filtering_rules;
+    _patterns.clear();
+    for (const auto& styled_rule: rules)
+    {
+        if (!styled_rule.rule.rule.isValid())
+            continue;
+
+        if (styled_rule.rule.behaviour != filtering_behaviour_t::none)
+            filtering_rules.push_back({styled_rule.rule.rule, styled_rule.rule.behaviour});
+        if (std::find(_patterns.begin(), _patterns.end(), styled_rule.rule.rule) == _patterns.end())
+            _patterns.push_back(styled_rule.rule.rule);
+    }
+
+    // Only the patterns and behaviours have an impact on the filtering. Changes to the name,
+    // tooltip or highlighting of the rules don't.
+    const bool is_same_filtering = std::equal(
+        _rules.begin(),
+        _rules.end(),
+        filtering_rules.begin(),
+        filtering_rules.end(),
+        [](const rule_t& lhs, const rule_t& rhs) {
+            return (lhs.pattern == rhs.pattern) && (lhs.behaviour == rhs.behaviour);
+        });
+
+    _rules = std::move(filtering_rules);
+
+    // Forget the matches of the patterns which are not used by any rule anymore.
+    auto is_unused = [&rules](const matches_t& matches) {
+        return std::none_of(rules.begin(), rules.end(), [&](const styled_matching_rule_t& rule) {
+            return rule.rule.rule == matches.pattern;
+        });
+    };
+    _matches.erase(std::remove_if(_matches.begin(), _matches.end(), is_unused), _matches.end());
+
+    return !is_same_filtering;
+}
+
+bool line_filter_t::set_show_lines_by_default(bool show_lines_by_default)
+{
+    if (_show_lines_by_default == show_lines_by_default)
+        return false;
+
+    _show_lines_by_default = show_lines_by_default;
+    return true;
+}
+
+bool line_filter_t::set_max_line_size(std::size_t max_line_size)
+{
+    if (_max_line_size == max_line_size)
+        return false;
+
+    _max_line_size = max_line_size;
+    forget_lines_from(0);
+    return true;
+}
+
+void line_filter_t::forget_lines_from(std::size_t first_line)
+{
+    for (auto& matches: _matches)
+    {
+        if (matches.line_count <= first_line)
+            continue;
+
+        matches.line_count = first_line;
+        matches.words.resize(word_count_for(first_line));
+        if (!matches.words.empty())
+            matches.words.back() &= mask_for(matches.words.size() - 1, 0, first_line);
+    }
+}
+
+void line_filter_t::remove_first_lines(std::size_t line_count)
+{
+    for (auto& matches: _matches)
+    {
+        matches.line_count -= std::min(line_count, matches.line_count);
+        remove_first_bits(matches.words, line_count, matches.line_count);
+    }
+}
+
+void line_filter_t::remove_first_lines(match_job_t& job, std::size_t line_count)
+{
+    job.last_line -= std::min(line_count, job.last_line);
+    for (auto& first_line: job.first_lines)
+        first_line -= std::min(line_count, first_line);
+    for (auto& words: job.words)
+        remove_first_bits(words, line_count, job.last_line);
+}
+
+std::size_t line_filter_t::matched_line_count() const
+{
+    std::size_t line_count = std::numeric_limits<std::size_t>::max();
+    for (const auto& rule: _rules)
+    {
+        const auto matches = find_matches(rule.pattern);
+        line_count = std::min(line_count, matches ? matches->line_count : 0);
+    }
+
+    return line_count;
+}
+
+void line_filter_t::shown_lines(std::size_t last_line, line_visibility_t& visibility) const
+{
+    const std::size_t first_line = visibility.line_count();
+    if (first_line >= last_line)
+        return;
+
+    // All the rules must have been matched up to last_line, see matched_line_count(). Otherwise
+    // a rule without matches is skipped rather than read out of bounds.
+    std::vector<const std::uint64_t*> rule_words;
+    for (const auto& rule: _rules)
+    {
+        const auto matches = find_matches(rule.pattern);
+        assert(matches && (matches->line_count >= last_line));
+        rule_words.push_back(matches ? matches->words.data() : nullptr);
+    }
+
+    std::vector<std::uint64_t> shown_words;
+    const std::uint64_t default_mask = _show_lines_by_default ? ~std::uint64_t{0} : 0;
+    for (auto word_index = first_line / bits_per_word; word_index < word_count_for(last_line);
+         ++word_index)
+    {
+        // The first matching rule decides of the visibility of a line, so each rule only applies
+        // to the lines not decided yet by a previous rule.
+        std::uint64_t undecided = mask_for(word_index, first_line, last_line);
+        std::uint64_t shown = 0;
+        for (std::size_t rule_index = 0; (rule_index < _rules.size()) && undecided; ++rule_index)
+        {
+            if (!rule_words[rule_index])
+                continue;
+
+            const std::uint64_t matching = rule_words[rule_index][word_index] & undecided;
+            if (_rules[rule_index].behaviour == filtering_behaviour_t::keep_line)
+                shown |= matching;
+            undecided &= ~matching;
+        }
+        shown |= undecided & default_mask;
+        shown_words.push_back(shown);
+    }
+
+    visibility.append(shown_words, last_line);
+}
+
+line_filter_t::matches_t& line_filter_t::matches_for(const QRegularExpression& pattern)
+{
+    auto it = std::find_if(_matches.begin(), _matches.end(), [&](const matches_t& matches) {
+        return matches.pattern == pattern;
+    });
+    if (it != _matches.end())
+        return *it;
+
+    auto& matches = _matches.emplace_back();
+    matches.pattern = pattern;
+    return matches;
+}
+
+std::vector<std::uint64_t> line_filter_t::shown_lines_in(
+    const line_store_t& lines,
+    std::size_t first_line,
+    std::size_t last_line) const
+{
+    const std::size_t first_word_index = first_line / bits_per_word;
+    std::vector<std::uint64_t> words(word_count_for(last_line) - first_word_index, 0);
+
+    std::vector<const matches_t*> rule_matches;
+    for (const auto& rule: _rules)
+        rule_matches.push_back(find_matches(rule.pattern));
+
+    for (auto line = first_line; line < last_line; ++line)
+    {
+        // The existing matches are used when there are some, and the line is only decoded if a
+        // rule has not been matched against it yet.
+        std::optional<QString> text;
+        bool is_shown = _show_lines_by_default;
+        for (std::size_t rule_index = 0; rule_index < _rules.size(); ++rule_index)
+        {
+            const auto matches = rule_matches[rule_index];
+            bool is_matching = false;
+            if (matches && (line < matches->line_count))
+            {
+                is_matching = (matches->words[line / bits_per_word] >> (line % bits_per_word))
+                    & std::uint64_t{1};
+            }
+            else
+            {
+                if (!text)
+                    text =
+                        QString::fromUtf8(truncated_line(lines.line_bytes(line), _max_line_size));
+                is_matching = _rules[rule_index].pattern.match(*text).hasMatch();
+            }
+
+            if (is_matching)
+            {
+                is_shown = (_rules[rule_index].behaviour == filtering_behaviour_t::keep_line);
+                break;
+            }
+        }
+
+        if (is_shown)
+            words[line / bits_per_word - first_word_index] |= std::uint64_t{1}
+                << (line % bits_per_word);
+    }
+
+    return words;
+}
+
+const line_filter_t::matches_t*
+line_filter_t::find_matches(const QRegularExpression& pattern) const
+{
+    auto it = std::find_if(_matches.begin(), _matches.end(), [&](const matches_t& matches) {
+        return matches.pattern == pattern;
+    });
+    return (it != _matches.end()) ? &*it : nullptr;
+}
+
+line_filter_t::match_job_t line_filter_t::match_job(std::size_t last_line)
+{
+    match_job_t job;
+    job.last_line = last_line;
+    job.max_line_size = _max_line_size;
+
+    // Match the patterns of all the valid rules, so that changing the behaviour of a rule only
+    // combines the matches again, and only for the lines which have not been matched yet. A
+    // pattern used by several rules is only matched once.
+    for (const auto& pattern: _patterns)
+    {
+        const auto& matches = matches_for(pattern);
+        if (matches.line_count < last_line)
+        {
+            job.patterns.push_back(matches.pattern);
+            job.first_lines.push_back(matches.line_count);
+        }
+    }
+
+    if (!job.is_empty())
+    {
+        job.matcher = multi_pattern_matcher_t{job.patterns};
+        job.words.resize(job.patterns.size());
+    }
+
+    return job;
+}
+
+bool line_filter_t::run(
+    match_job_t& job,
+    const line_store_t& lines,
+    const std::atomic_bool& is_cancelled)
+{
+    if (job.is_empty())
+        return true;
+
+    for (auto& words: job.words)
+        words.assign(word_count_for(job.last_line), 0);
+
+    struct task_t
+    {
+        std::size_t first_line;
+        std::size_t last_line;
+    };
+
+    // Tasks are aligned on words so that they never write to the same word.
+    const auto first_line = *std::min_element(job.first_lines.begin(), job.first_lines.end());
+    std::vector<task_t> tasks;
+    for (auto line = first_line; line < job.last_line;)
+    {
+        const auto task_last_line =
+            std::min((line / lines_per_task + 1) * lines_per_task, job.last_line);
+        tasks.push_back({line, task_last_line});
+        line = task_last_line;
+    }
+
+    auto match = [&](const task_t& task) {
+        multi_pattern_matcher_t::candidates_t candidates;
+        for (auto line = task.first_line; (line < task.last_line) && !is_cancelled; ++line)
+        {
+            // A single scan of the line finds the patterns which might match it, and the line is
+            // only decoded if there is at least one.
+            const auto bytes = truncated_line(lines.line_bytes(line), job.max_line_size);
+            job.matcher.find_candidates(bytes, candidates);
+
+            std::optional<QString> text;
+            for (std::size_t pattern = 0; pattern < job.patterns.size(); ++pattern)
+            {
+                if ((line < job.first_lines[pattern])
+                    || !multi_pattern_matcher_t::is_candidate(candidates, pattern))
+                    continue;
+
+                if (!text)
+                    text = QString::fromUtf8(bytes);
+                if (job.patterns[pattern].match(*text).hasMatch())
+                    job.words[pattern][line / bits_per_word] |= std::uint64_t{1}
+                        << (line % bits_per_word);
+            }
+        }
+    };
+
+    // Dispatching a single task to the thread pool would only add latency.
+    if (tasks.size() == 1)
+        match(tasks.front());
+    else if (tasks.size() > 1)
+        QtConcurrent::blockingMap(tasks, match);
+
+    return !is_cancelled;
+}
+
+void line_filter_t::merge(match_job_t job, std::size_t valid_line_count)
+{
+    for (std::size_t pattern = 0; pattern < job.patterns.size(); ++pattern)
+    {
+        auto it = std::find_if(_matches.begin(), _matches.end(), [&](const matches_t& matches) {
+            return matches.pattern == job.patterns[pattern];
+        });
+
+        // The matches must continue exactly where the job started.
+        if ((it == _matches.end()) || (it->line_count != job.first_lines[pattern]))
+            continue;
+
+        // The bits of the lines before the job are always cleared in the job results, and the
+        // bits of the lines after the current matches are always cleared in the matches.
+        auto& words = job.words[pattern];
+        it->words.resize(words.size(), 0);
+        for (std::size_t word_index = job.first_lines[pattern] / bits_per_word;
+             word_index < words.size();
+             ++word_index)
+            it->words[word_index] |= words[word_index];
+        it->line_count = job.last_line;
+    }
+
+    forget_lines_from(valid_line_count);
+}
+} // namespace flan
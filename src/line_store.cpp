@@ -0,0 +1,239 @@
+#include <flan/line_store.hpp>
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+namespace flan
+{
+QByteArrayView truncated_line(QByteArrayView line, std::size_t max_size)
+{
+    if ((max_size == 0) || (static_cast<std::size_t>(line.size()) <= max_size))
+        return line;
+
+    // Continuation bytes of a UTF-8 sequence are 10xxxxxx, so move back to the start of the
+    // sequence cut, if any.
+    std::size_t size = max_size;
+    while ((size > 0) && ((static_cast<unsigned char>(line[size]) & 0xC0) == 0x80))
+        --size;
+
+    return line.first(static_cast<qsizetype>(size));
+}
+
+line_store_t::line_store_t(std::size_t chunk_capacity)
+    : _chunk_capacity{chunk_capacity}
+{
+}
+
+void line_store_t::append(QByteArrayView text)
+{
+    const char* begin = text.data();
+    const char* end = begin + text.size();
+
+    while (begin != end)
+    {
+        auto new_line = static_cast<const char*>(std::memchr(begin, '\n', end - begin));
+        if (!new_line)
+        {
+            append_to_last_line(begin, end - begin);
+            break;
+        }
+
+        append_to_last_line(begin, new_line + 1 - begin);
+        terminate_last_line();
+        begin = new_line + 1;
+    }
+}
+
+void line_store_t::append(line_block_ptr_t block)
+{
+    if (!block || block->line_ends.empty())
+        return;
+
+    if (!is_last_line_complete())
+        terminate_last_line();
+
+    auto& chunk = *_chunks.emplace_back(std::make_shared<chunk_t>());
+    chunk.first_line = _complete_line_count;
+    chunk.block = std::move(block);
+
+    _complete_line_count += chunk.block->line_ends.size();
+    _byte_count += chunk.block->data.size();
+    _max_line_length = std::max(_max_line_length, chunk.block->max_line_length);
+}
+
+void line_store_t::clear()
+{
+    _chunks.clear();
+    _complete_line_count = 0;
+    _removed_line_count = 0;
+    _byte_count = 0;
+    _max_line_length = 0;
+}
+
+void line_store_t::truncate(std::size_t line)
+{
+    if (line >= line_count())
+        return;
+
+    const std::size_t index = line + _removed_line_count;
+    auto it = std::upper_bound(
+        _chunks.begin(),
+        _chunks.end(),
+        index,
+        [](std::size_t line, const std::shared_ptr<chunk_t>& chunk) {
+            return line < chunk->first_line;
+        });
+    _chunks.erase(it, _chunks.end());
+
+    // The lines of the chunk before line are copied to a new chunk owned by the store, which then
+    // becomes the last one.
+    const auto& old_chunk = *_chunks.back();
+    const std::size_t kept_line_count = index - old_chunk.first_line;
+    const std::size_t kept_size =
+        (kept_line_count == 0) ? 0 : old_chunk.ends()[kept_line_count - 1];
+
+    auto chunk = std::make_shared<chunk_t>();
+    chunk->first_line = old_chunk.first_line;
+    chunk->data.reserve(std::max(_chunk_capacity, kept_size));
+    chunk->data.assign(old_chunk.bytes(), old_chunk.bytes() + kept_size);
+    chunk->line_ends.assign(
+        old_chunk.ends().begin(), old_chunk.ends().begin() + kept_line_count);
+    _chunks.back() = std::move(chunk);
+
+    _complete_line_count = index;
+    _byte_count = 0;
+    for (const auto& kept_chunk: _chunks)
+        _byte_count += kept_chunk->size();
+}
+
+std::size_t
+line_store_t::remove_oldest_lines(std::size_t max_line_count, std::size_t max_byte_count)
+{
+    auto is_over_limits = [&]() {
+        return ((max_line_count != 0) && (line_count() > max_line_count))
+            || ((max_byte_count != 0) && (_byte_count > max_byte_count));
+    };
+
+    std::size_t chunk_count = 0;
+    const std::size_t old_removed_line_count = _removed_line_count;
+    while ((chunk_count + 1 < _chunks.size()) && is_over_limits())
+    {
+        // Every chunk but the last one only holds complete lines.
+        const auto& chunk = *_chunks[chunk_count++];
+        _removed_line_count += chunk.ends().size();
+        _byte_count -= chunk.size();
+    }
+
+    // The longest line might have been removed but this is only used as a hint for the width of
+    // the content, so it is not worth scanning all the lines left.
+    _chunks.erase(_chunks.begin(), _chunks.begin() + chunk_count);
+    return _removed_line_count - old_removed_line_count;
+}
+
+line_store_t line_store_t::snapshot() const
+{
+    line_store_t snapshot{*this};
+    if (!snapshot._chunks.empty() && !snapshot._chunks.back()->block)
+        snapshot._chunks.back() = std::make_shared<chunk_t>(*snapshot._chunks.back());
+
+    return snapshot;
+}
+
+std::size_t line_store_t::line_count() const
+{
+    return _complete_line_count - _removed_line_count + (is_last_line_complete() ? 0 : 1);
+}
+
+bool line_store_t::is_last_line_complete() const
+{
+    if (_chunks.empty())
+        return true;
+
+    const auto& chunk = *_chunks.back();
+    const std::size_t last_line_end = chunk.ends().empty() ? 0 : chunk.ends().back();
+    return chunk.size() == last_line_end;
+}
+
+QByteArrayView line_store_t::line_bytes(std::size_t line) const
+{
+    assert(line < line_count());
+
+    const auto& chunk = chunk_for_line(line);
+    const auto& line_ends = chunk.ends();
+    const std::size_t index = line + _removed_line_count - chunk.first_line;
+    const std::size_t start = (index == 0) ? 0 : line_ends[index - 1];
+    std::size_t end = (index < line_ends.size()) ? line_ends[index] : chunk.size();
+
+    // Strip the line terminator, which is either "\n" or "\r\n". A "\r" at the end of the
+    // incomplete last line is stripped as well since it is most likely followed by a "\n" which
+    // has not been received yet.
+    const char* data = chunk.bytes();
+    if ((end > start) && (data[end - 1] == '\n'))
+        --end;
+    if ((end > start) && (data[end - 1] == '\r'))
+        --end;
+
+    return QByteArrayView{data + start, static_cast<qsizetype>(end - start)};
+}
+
+const line_store_t::chunk_t& line_store_t::chunk_for_line(std::size_t line) const
+{
+    // Chunks are sorted by their first line, so find the last chunk starting at or before line.
+    auto it = std::upper_bound(
+        _chunks.begin(),
+        _chunks.end(),
+        line + _removed_line_count,
+        [](std::size_t line, const std::shared_ptr<chunk_t>& chunk) {
+            return line < chunk->first_line;
+        });
+    assert(it != _chunks.begin());
+
+    return **std::prev(it);
+}
+
+line_store_t::chunk_t& line_store_t::new_chunk()
+{
+    auto& chunk = *_chunks.emplace_back(std::make_shared<chunk_t>());
+    chunk.first_line = _complete_line_count;
+    chunk.data.reserve(_chunk_capacity);
+
+    return chunk;
+}
+
+void line_store_t::append_to_last_line(const char* data, std::size_t size)
+{
+    // Lines from a block can't be modified, so start a new chunk after them.
+    if (_chunks.empty() || _chunks.back()->block)
+        new_chunk();
+
+    auto* chunk = _chunks.back().get();
+    std::size_t line_start = chunk->line_ends.empty() ? 0 : chunk->line_ends.back();
+
+    // A line never spans several chunks. If the line doesn't fit in the current chunk, move the
+    // part of the line already received to a new chunk. A line larger than the chunk capacity
+    // ends up alone in its chunk which then grows as needed.
+    if ((chunk->data.size() + size > _chunk_capacity) && (line_start != 0))
+    {
+        std::vector<char> partial_line{chunk->data.begin() + line_start, chunk->data.end()};
+        chunk->data.resize(line_start);
+
+        chunk = &new_chunk();
+        chunk->data.insert(chunk->data.end(), partial_line.begin(), partial_line.end());
+        line_start = 0;
+    }
+
+    chunk->data.insert(chunk->data.end(), data, data + size);
+    _byte_count += size;
+    _max_line_length = std::max(_max_line_length, chunk->data.size() - line_start);
+}
+
+void line_store_t::terminate_last_line()
+{
+    if (_chunks.empty() || _chunks.back()->block)
+        new_chunk();
+
+    auto& chunk = *_chunks.back();
+    chunk.line_ends.push_back(static_cast<std::uint32_t>(chunk.data.size()));
+    ++_complete_line_count;
+}
+} // namespace flan
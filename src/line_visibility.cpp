@@ -0,0 +1,115 @@
+#include "line_bits.hpp"
+#include <flan/line_visibility.hpp>
+#include <QtAlgorithms>
+#include <algorithm>
+#include <cassert>
+
+namespace flan
+{
+bool line_visibility_t::is_shown(std::size_t line) const
+{
+    return (line < _line_count)
+        && ((_words[line / bits_per_word] >> (line % bits_per_word)) & std::uint64_t{1});
+}
+
+std::size_t line_visibility_t::rank(std::size_t line) const
+{
+    if (line >= _line_count)
+        return _shown_line_count;
+
+    const std::size_t word_index = line / bits_per_word;
+    return _ranks[word_index]
+        + qPopulationCount(_words[word_index] & mask_for(word_index, 0, line));
+}
+
+std::size_t line_visibility_t::select(std::size_t rank) const
+{
+    assert(rank < _shown_line_count);
+
+    // The line is in the last word with less lines shown before it than rank. Words without any
+    // line shown have the same rank as the next one, so they are skipped.
+    auto it = std::upper_bound(_ranks.begin(), _ranks.end(), rank);
+    const std::size_t word_index = std::distance(_ranks.begin(), it) - 1;
+
+    std::uint64_t word = _words[word_index];
+    for (std::size_t skipped = rank - _ranks[word_index]; skipped > 0; --skipped)
+        word &= word - 1;
+
+    return word_index * bits_per_word + qCountTrailingZeroBits(word);
+}
+
+void line_visibility_t::append(const std::vector<std::uint64_t>& words, std::size_t last_line)
+{
+    if (last_line <= _line_count)
+        return;
+
+    assert(words.size() == word_count_for(last_line) - _line_count / bits_per_word);
+
+    // The first word might already hold some of the previous lines.
+    const std::size_t first_word_index = _line_count / bits_per_word;
+    auto word = words.begin();
+    if (first_word_index < _words.size())
+        _words.back() |= *word++;
+    _words.insert(_words.end(), word, words.end());
+
+    _line_count = last_line;
+    update_ranks_from(first_word_index);
+}
+
+void line_visibility_t::set_lines(
+    std::size_t first_line,
+    std::size_t last_line,
+    const std::vector<std::uint64_t>& words)
+{
+    last_line = std::min(last_line, _line_count);
+    if (first_line >= last_line)
+        return;
+
+    const std::size_t first_word_index = first_line / bits_per_word;
+    for (auto word_index = first_word_index; word_index < word_count_for(last_line); ++word_index)
+    {
+        const std::uint64_t mask = mask_for(word_index, first_line, last_line);
+        _words[word_index] =
+            (_words[word_index] & ~mask) | (words[word_index - first_word_index] & mask);
+    }
+
+    update_ranks_from(first_word_index);
+}
+
+void line_visibility_t::truncate(std::size_t line_count)
+{
+    if (line_count >= _line_count)
+        return;
+
+    _line_count = line_count;
+    _words.resize(word_count_for(line_count));
+    if (!_words.empty())
+        _words.back() &= mask_for(_words.size() - 1, 0, line_count);
+
+    update_ranks_from(_words.empty() ? 0 : _words.size() - 1);
+}
+
+void line_visibility_t::remove_first_lines(std::size_t line_count)
+{
+    _line_count -= std::min(line_count, _line_count);
+    remove_first_bits(_words, line_count, _line_count);
+    update_ranks_from(0);
+}
+
+void line_visibility_t::update_ranks_from(std::size_t word_index)
+{
+    _ranks.resize(_words.size());
+
+    std::size_t rank = 0;
+    if ((word_index > 0) && (word_index <= _words.size()))
+        rank = _ranks[word_index - 1] + qPopulationCount(_words[word_index - 1]);
+
+    for (; word_index < _words.size(); ++word_index)
+    {
+        _ranks[word_index] = rank;
+        rank += qPopulationCount(_words[word_index]);
+    }
+
+    _shown_line_count = rank;
+}
+} // namespace flan
@@ -2,15 +2,131 @@
 #include <flan/log_margin_area_widget.hpp>
 #include <flan/log_widget.hpp>
 #include <flan/timestamp_format_settings_dialog.hpp>
+#include <flan/timestamp_parser.hpp>
+#include <QInputDialog>
+#include <QMessageBox>
 #include <QPainter>
-#include <QTime>
+#include <QRegularExpression>
+#include <limits>
+#include <optional>
 
 namespace flan
 {
 namespace
 {
 static constexpr int _number_area_margin = 4;
+
+//! Return the duration written as numbers followed by units (d, h, m, s, ms, us or ns), e.g.
+//! "1h30m" or "2s 500ms", in nanoseconds. Return std::nullopt if \a text is not a duration.
+std::optional<qint64> duration_for_input(const QString& text)
+{
+    static const QRegularExpression component{QStringLiteral("\\s*(\\d+)\\s*(d|h|ms|m|us|ns|s)")};
+
+    qint64 duration = 0;
+    qsizetype position = 0;
+    while (position < text.size())
+    {
+        const auto match = component.match(
+            text,
+            position,
+            QRegularExpression::NormalMatch,
+            QRegularExpression::AnchorAtOffsetMatchOption);
+        if (!match.hasMatch())
+            return std::nullopt;
+
+        qint64 unit = 1;
+        const QStringView unit_name = match.capturedView(2);
+        if (unit_name == u"d")
+            unit = nanoseconds_per_day;
+        else if (unit_name == u"h")
+            unit = 3600 * nanoseconds_per_second;
+        else if (unit_name == u"m")
+            unit = 60 * nanoseconds_per_second;
+        else if (unit_name == u"s")
+            unit = nanoseconds_per_second;
+        else if (unit_name == u"ms")
+            unit = 1000 * 1000;
+        else if (unit_name == u"us")
+            unit = 1000;
+
+        bool is_number = false;
+        const qint64 value = match.capturedView(1).toLongLong(&is_number);
+        if (!is_number || (value > (std::numeric_limits<qint64>::max() - duration) / unit))
+            return std::nullopt;
+
+        duration += value * unit;
+        position = match.capturedEnd(0);
+    }
+
+    return (position > 0) ? std::optional<qint64>{duration} : std::nullopt;
+}
+
+//! Return the point in time written in \a text, or no_timestamp if it is invalid.
+//!
+//! \a text is either a date and a time, a time, or a duration relative to \a reference preceded
+//! by a sign, e.g. "2024-05-01T14:32:07", "14:32:07.250" or "-1h30m". A time without a date is on
+//! the day of \a reference. A date or a time can be followed by an offset from UTC (e.g.
+//! "14:32:07+02:00" or "2024-05-01T12:32:07Z"), otherwise it is in UTC like the timestamps of the
+//! lines. The whole text must match, e.g. "14:32:07 tomorrow" is invalid.
+timestamp_t timestamp_for_input(const QString& text, timestamp_t reference)
+{
+    const QString trimmed_text = text.trimmed();
+    if (trimmed_text.startsWith(QLatin1Char('+')) || trimmed_text.startsWith(QLatin1Char('-')))
+    {
+        const auto duration = duration_for_input(trimmed_text.mid(1));
+        if (!duration || (reference == no_timestamp))
+            return no_timestamp;
+
+        return trimmed_text.startsWith(QLatin1Char('+')) ? reference + *duration
+                                                         : reference - *duration;
+    }
+
+    struct input_format_t
+    {
+        const char* spec;
+        bool has_date;
+    };
+
+    static const input_format_t formats[] = {
+        {"%Y-%m-%dT%H:%M:%S.%f", true},
+        {"%Y-%m-%d %H:%M:%S.%f", true},
+        {"%Y-%m-%dT%H:%M:%S", true},
+        {"%Y-%m-%d %H:%M:%S", true},
+        {"%Y-%m-%dT%H:%M", true},
+        {"%Y-%m-%d %H:%M", true},
+        {"%Y-%m-%d", true},
+        {"%H:%M:%S.%f", false},
+        {"%H:%M:%S", false},
+        {"%H:%M", false},
+    };
+
+    const QByteArray bytes = trimmed_text.toUtf8();
+    for (const auto& format: formats)
+    {
+        // The offset from UTC is optional.
+        const QString spec = QString::fromLatin1(format.spec);
+        timestamp_t timestamp = timestamp_parser_t{spec}.exact_timestamp_for(bytes);
+        if (timestamp == no_timestamp)
+            timestamp = timestamp_parser_t{spec + QStringLiteral("%z")}.exact_timestamp_for(bytes);
+        if (timestamp == no_timestamp)
+            continue;
+
+        if (!format.has_date && (reference != no_timestamp))
+        {
+            // Round the days down so that a time is on the same day as the reference.
+            qint64 days = reference / nanoseconds_per_day;
+            if (reference % nanoseconds_per_day < 0)
+                --days;
+
+            timestamp += days * nanoseconds_per_day;
+        }
+
+        return timestamp;
+    }
+
+    return no_timestamp;
 }
+} // namespace
 
 int log_margin_area_widget_t::ideal_width() const
 {
@@ -19,20 +135,36 @@ int log_margin_area_widget_t::ideal_width() const
 
     if (use_timestamp())
     {
-        width +=
-            fontMetrics().horizontalAdvance(QTime{23, 59, 59, 999}.toString(Qt::ISODateWithMs));
+        // Dates are only shown if some timestamps have one, and the difference between two of
+        // them can then be several days.
+        QString widest_text = timestamp_to_string(nanoseconds_per_day - 1);
+        if (_log_widget->_timestamps.has_dates())
+        {
+            widest_text = use_relative_value()
+                ? duration_to_string(1000 * nanoseconds_per_day - 1)
+                : timestamp_to_string(
+                    timestamp_from({9999, 12, 31}) + nanoseconds_per_day - 1);
+        }
+
+        width += fontMetrics().horizontalAdvance(widest_text);
     }
     else
     {
         int digits = 1;
-        int max = qMax(1, _log_widget->blockCount());
+        std::size_t max = std::max<std::size_t>(1, _log_widget->line_count());
 
         if (use_relative_value())
         {
-            // because it is relative, things start at 0 (e.g. if blockCount == 10 the max number
+            // because it is relative, things start at 0 (e.g. if line_count == 10 the max number
             // in the margin will be 9, not 10)
             --max;
         }
+        else
+        {
+            // Lines removed by the retention policy are still counted so that line numbers don't
+            // change when the oldest lines are removed.
+            max += _log_widget->removed_line_count();
+        }
 
         while (max >= 10)
         {
@@ -55,15 +187,20 @@ log_margin_area_widget_t::log_margin_area_widget_t(log_widget_t* log_widget)
     , _use_relative_value_action{new QAction{tr("Use relative value"), this}}
     , _use_timestamp_action{new QAction{tr("Use timestamp"), this}}
     , _timestamp_format_settings_action{new QAction{tr("Timestamp formats..."), this}}
+    , _go_to_time_action{new QAction{tr("Go to time..."), this}}
 {
     connect(
         _log_widget,
-        &log_widget_t::blockCountChanged,
+        &log_widget_t::line_count_changed,
         this,
         &log_margin_area_widget_t::update_width);
     connect(
-        _log_widget, &log_widget_t::updateRequest, this, &log_margin_area_widget_t::update_area);
-    connect(_log_widget, &log_widget_t::cursorPositionChanged, this, [this]() {
+        _log_widget,
+        &log_widget_t::viewport_resized,
+        this,
+        &log_margin_area_widget_t::update_width);
+    connect(_log_widget, &log_widget_t::viewport_updated, this, [this]() { update(); });
+    connect(_log_widget, &log_widget_t::cursor_position_changed, this, [this]() {
         if (use_relative_value())
             update();
     });
@@ -81,6 +218,11 @@ log_margin_area_widget_t::log_margin_area_widget_t(log_widget_t* log_widget)
     _use_timestamp_action->setCheckable(true);
     connect(
         _use_timestamp_action, &QAction::toggled, this, &log_margin_area_widget_t::update_width);
+    connect(
+        _use_timestamp_action,
+        &QAction::toggled,
+        this,
+        &log_margin_area_widget_t::update_timestamp_formats);
     addAction(_use_timestamp_action);
 
     connect(
@@ -90,55 +232,45 @@ log_margin_area_widget_t::log_margin_area_widget_t(log_widget_t* log_widget)
         &log_margin_area_widget_t::show_timestamp_format_settings_dialog);
     addAction(_timestamp_format_settings_action);
 
+    // The action is also added to the log so that its shortcut works when the log has the focus.
+    _go_to_time_action->setShortcut(QKeySequence{tr("Ctrl+T")});
+    _go_to_time_action->setShortcutContext(Qt::WidgetWithChildrenShortcut);
+    connect(_go_to_time_action, &QAction::triggered, this, &log_margin_area_widget_t::go_to_time);
+    addAction(_go_to_time_action);
+    _log_widget->addAction(_go_to_time_action);
+
     setContextMenuPolicy(Qt::ActionsContextMenu);
 }
 
 void log_margin_area_widget_t::set_timestamp_formats(timestamp_format_list_t formats)
 {
     _timestamp_formats = std::move(formats);
-    if (use_timestamp())
-        update();
+    update_timestamp_formats();
 }
 
-QString log_margin_area_widget_t::text_for_block(const QTextBlock& block)
+QString log_margin_area_widget_t::text_for_line(std::size_t line)
 {
     if (use_timestamp())
     {
-        if (auto timestamp = get_block_timestamp(block); timestamp.isValid())
-        {
-            if (use_relative_value())
-            {
-                auto cursor_timestamp = get_block_timestamp(_log_widget->textCursor().block());
-                if (cursor_timestamp.isValid())
-                {
-                    auto relative_timestamp = QTime::fromMSecsSinceStartOfDay(qAbs(
-                        cursor_timestamp.msecsSinceStartOfDay()
-                        - timestamp.msecsSinceStartOfDay()));
-
-                    QString text;
-                    if (cursor_timestamp > timestamp)
-                        text.append('-');
-
-                    text.append(relative_timestamp.toString(Qt::ISODateWithMs));
-                    return text;
-                }
-                else
-                {
-                    return {};
-                }
-            }
-            else
-            {
-                return timestamp.toString(Qt::ISODateWithMs);
-            }
-        }
+        const timestamp_t timestamp = _log_widget->timestamp(line);
+        if (timestamp == no_timestamp)
+            return {};
+
+        if (!use_relative_value())
+            return timestamp_to_string(timestamp);
 
-        return {};
+        const timestamp_t cursor_timestamp =
+            _log_widget->timestamp(_log_widget->cursor_position().line);
+        if (cursor_timestamp == no_timestamp)
+            return {};
+
+        return duration_to_string(timestamp - cursor_timestamp);
     }
     else if (use_relative_value())
-        return QString::number(block.blockNumber() - _log_widget->textCursor().blockNumber());
+        return QString::number(
+            static_cast<qint64>(line) - static_cast<qint64>(_log_widget->cursor_position().line));
     else
-        return QString::number(block.blockNumber() + 1);
+        return QString::number(_log_widget->removed_line_count() + line + 1);
 }
 
 bool log_margin_area_widget_t::use_relative_value() const
@@ -151,77 +283,79 @@ bool log_margin_area_widget_t::use_timestamp() const
     return _use_timestamp_action->isChecked();
 }
 
-QTime log_margin_area_widget_t::get_block_timestamp(const QTextBlock& block) const
-{
-    for (const auto& format: _timestamp_formats)
-    {
-        if (auto time = format.time_for(block.text()); time.isValid())
-            return time;
-    }
-
-    return {};
-}
-
 void log_margin_area_widget_t::paintEvent(QPaintEvent* event)
 {
     QPainter painter{this};
     painter.fillRect(event->rect(), palette().color(backgroundRole()).darker(105));
 
-    QTextBlock block = _log_widget->firstVisibleBlock();
-    int top = qRound(
-        _log_widget->blockBoundingGeometry(block).translated(_log_widget->contentOffset()).top());
-    int bottom = top + qRound(_log_widget->blockBoundingRect(block).height());
+    // The text of a row is shown next to its first line, as wrapped rows take several lines.
+    const int line_height = _log_widget->line_height();
+    const int first_row = _log_widget->first_visible_row();
+    const std::size_t cursor_line = _log_widget->cursor_position().line;
 
-    while (block.isValid() && top <= event->rect().bottom())
+    for (int row = first_row, top = 0;
+         (row < _log_widget->row_count()) && (top <= event->rect().bottom());
+         top += _log_widget->row_height(row++))
     {
-        if (block.isVisible() && bottom >= event->rect().top())
-        {
-            // Use a bold font for the current line
-            auto font = painter.font();
-            font.setBold(block == _log_widget->textCursor().block());
-            painter.setFont(font);
-
-            painter.drawText(
-                -_number_area_margin,
-                top,
-                width(),
-                fontMetrics().height(),
-                Qt::AlignRight,
-                text_for_block(block));
-        }
-
-        block = block.next();
-        top = bottom;
-        bottom = top + qRound(_log_widget->blockBoundingRect(block).height());
+        if (top + line_height < event->rect().top())
+            continue;
+
+        const std::size_t line = _log_widget->line_at_row(row);
+
+        // Use a bold font for the current line
+        auto font = painter.font();
+        font.setBold(line == cursor_line);
+        painter.setFont(font);
+
+        painter.drawText(
+            -_number_area_margin,
+            top,
+            width(),
+            line_height,
+            Qt::AlignRight,
+            text_for_line(line));
     }
 }
 
+void log_margin_area_widget_t::changeEvent(QEvent* event)
+{
+    QWidget::changeEvent(event);
+
+    // The font follows the one of the log, e.g. when zooming.
+    if (event->type() == QEvent::FontChange)
+        update_width();
+}
+
 void log_margin_area_widget_t::update_width()
 {
-    _log_widget->setViewportMargins(ideal_width(), 0, 0, 0);
+    // Changing the margins lays out the log widget again, so only do it when the width changes
+    // (e.g. not every time lines are appended).
+    const int margin_width = ideal_width();
+    if (_log_widget->viewportMargins().left() != margin_width)
+        _log_widget->setViewportMargins(margin_width, 0, 0, 0);
 
     QRect r = _log_widget->contentsRect();
-    setGeometry(QRect(r.left(), r.top(), ideal_width(), r.height()));
+    setGeometry(QRect(r.left(), r.top(), margin_width, r.height()));
 }
 
-void log_margin_area_widget_t::update_area(const QRect& rect, int dy)
+void log_margin_area_widget_t::update_timestamp_formats()
 {
-    if (dy)
-        scroll(0, dy);
-    else
-        update(0, rect.y(), width(), rect.height());
-
-    if (rect.contains(_log_widget->viewport()->rect()))
-        update_width();
+    // The log only parses the timestamps of its lines while they are displayed.
+    _log_widget->set_timestamp_formats(
+        use_timestamp() ? _timestamp_formats : timestamp_format_list_t{});
+    update_width();
+    update();
 }
 
 void log_margin_area_widget_t::show_timestamp_format_settings_dialog()
 {
     // Use the selected text as default test string. If nothing is selected, use the current
     // line.
-    QString default_test_string = _log_widget->textCursor().selectedText();
-    if (default_test_string.isEmpty())
-        default_test_string = _log_widget->textCursor().block().text();
+    QString default_test_string = _log_widget->plain_text_with_rules_applied();
+    if (default_test_string.isEmpty()
+        && (_log_widget->cursor_position().line < _log_widget->line_count()))
+        default_test_string =
+            _log_widget->displayed_text(_log_widget->cursor_position().line);
 
     timestamp_format_settings_dialog_t dialog{default_test_string, this};
     dialog.setModal(true);
@@ -230,4 +364,54 @@ void log_margin_area_widget_t::show_timestamp_format_settings_dialog()
     if (dialog.exec() == QDialog::Accepted)
         set_timestamp_formats(dialog.formats());
 }
+
+void log_margin_area_widget_t::go_to_time()
+{
+    // The timestamps of the lines are only parsed while they are shown.
+    _use_timestamp_action->setChecked(true);
+
+    // Showing the timestamps just started parsing the lines in the background, so the line of the
+    // cursor is parsed right away for the relative input.
+    const timestamp_t cursor_timestamp =
+        _log_widget->parse_timestamp(_log_widget->cursor_position().line);
+
+    bool is_accepted = false;
+    const QString text = QInputDialog::getText(
+        this,
+        tr("Go to time"),
+        tr("Date and time, time, or offset from the current line (e.g. \"14:32:07\", "
+           "\"2024-05-01 14:32:07.250+02:00\" or \"-1h30m\"):"),
+        QLineEdit::Normal,
+        timestamp_to_string(cursor_timestamp),
+        &is_accepted);
+    if (!is_accepted)
+        return;
+
+    const timestamp_t timestamp = timestamp_for_input(text, cursor_timestamp);
+    if (timestamp == no_timestamp)
+    {
+        QMessageBox::warning(this, tr("Go to time"), tr("\"%1\" is not a valid time.").arg(text));
+        return;
+    }
+
+    switch (_log_widget->go_to_timestamp(timestamp))
+    {
+    case log_widget_t::timestamp_search_t::found:
+        break;
+    case log_widget_t::timestamp_search_t::pending:
+        QMessageBox::information(
+            this,
+            tr("Go to time"),
+            tr("No line processed so far has a timestamp at or after %1, so the cursor is on the "
+               "last line processed. Try again once the log is fully processed.")
+                .arg(timestamp_to_string(timestamp)));
+        break;
+    case log_widget_t::timestamp_search_t::not_found:
+        QMessageBox::information(
+            this,
+            tr("Go to time"),
+            tr("No line has a timestamp at or after %1.").arg(timestamp_to_string(timestamp)));
+        break;
+    }
+}
 } // namespace flan
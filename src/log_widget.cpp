@@ -1,17 +1,35 @@
-
 #include <flan/log_widget.hpp>
-#include <flan/rule_highlighter.hpp>
 #include <QAction>
+#include <QClipboard>
 #include <QFont>
-#include <QMimeData>
-#include <QTextDocumentFragment>
-#include <QToolTip>
+#include <QGuiApplication>
+#include <QStringList>
+#include <QtAlgorithms>
+#include <QtConcurrent/QtConcurrentRun>
+#include <chrono>
+#include <utility>
 
 namespace flan
 {
+namespace
+{
+//! Minimum interval between two updates of the view when text is appended, about one display
+//! frame.
+static constexpr std::chrono::milliseconds _frame_interval{16};
+
+//! Maximum number of lines matched and parsed right away instead of in the background, so that
+//! lines streamed a few at a time are shown on the next frame.
+static constexpr std::size_t _max_lines_filtered_synchronously = 1024;
+
+//! Number of lines filtered at once when previewing the filtering of the viewport, and maximum
+//! number of lines filtered to fill it.
+static constexpr std::size_t _lines_per_preview_chunk = 1024;
+static constexpr std::size_t _max_lines_previewed = 16 * 1024;
+} // namespace
+
 log_widget_t::log_widget_t(const QString& text, QWidget* parent)
-    : QPlainTextEdit{text, parent}
-    , _highlighter{new rule_highlighter_t{document()}}
+    : QAbstractScrollArea{parent}
+    , _highlighter{new rule_highlighter_t{this}}
 {
     QFont font;
     font.setFamily("monospace");
@@ -19,15 +37,160 @@ log_widget_t::log_widget_t(const QString& text, QWidget* parent)
     font.setPointSize(10);
     setFont(font);
 
-    connect(this, &QPlainTextEdit::textChanged, this, &log_widget_t::apply_rules);
+    setFocusPolicy(Qt::StrongFocus);
+    viewport()->setCursor(Qt::IBeamCursor);
+    viewport()->setMouseTracking(true);
+
+    auto copy_action = new QAction{tr("Copy"), this};
+    copy_action->setShortcut(QKeySequence::Copy);
+    copy_action->setShortcutContext(Qt::WidgetWithChildrenShortcut);
+    connect(copy_action, &QAction::triggered, this, &log_widget_t::copy);
+    addAction(copy_action);
+
+    auto paste_action = new QAction{tr("Paste"), this};
+    paste_action->setShortcut(QKeySequence::Paste);
+    paste_action->setShortcutContext(Qt::WidgetWithChildrenShortcut);
+    connect(paste_action, &QAction::triggered, this, &log_widget_t::paste);
+    addAction(paste_action);
+
+    auto select_all_action = new QAction{tr("Select All"), this};
+    select_all_action->setShortcut(QKeySequence::SelectAll);
+    select_all_action->setShortcutContext(Qt::WidgetWithChildrenShortcut);
+    connect(select_all_action, &QAction::triggered, this, &log_widget_t::select_all);
+    addAction(select_all_action);
+
+    auto wrap_lines_action = new QAction{tr("Wrap Lines"), this};
+    wrap_lines_action->setCheckable(true);
+    wrap_lines_action->setChecked(_is_wrapping_lines);
+    connect(wrap_lines_action, &QAction::toggled, this, &log_widget_t::set_wrapping_lines);
+    addAction(wrap_lines_action);
+
+    setContextMenuPolicy(Qt::ActionsContextMenu);
+
+    _filtering_thread_pool.setMaxThreadCount(1);
+
+    _is_highlighting_cancelled = std::make_shared<std::atomic_bool>(false);
+
+    _prefetch_highlights_timer.setSingleShot(true);
+    _prefetch_highlights_timer.setInterval(0);
+    connect(
+        &_prefetch_highlights_timer,
+        &QTimer::timeout,
+        this,
+        &log_widget_t::prefetch_highlights);
+
+    _frame_timer.setSingleShot(true);
+    _frame_timer.setInterval(_frame_interval);
+    connect(&_frame_timer, &QTimer::timeout, this, &log_widget_t::update_frame);
+
+    _filter.set_max_line_size(_max_line_size);
+    _timestamps.set_max_line_size(_max_line_size);
+
+    set_text(text);
+}
+
+log_widget_t::~log_widget_t()
+{
+    // The background filtering and highlighting notify the widget when done, so they must not
+    // outlive it.
+    cancel_filtering();
+    _filtering.waitForFinished();
+    cancel_highlighting();
+    _highlighting_thread_pool.waitForDone();
+}
+
+void log_widget_t::set_cursor_position(log_position_t position, bool keep_anchor)
+{
+    const auto old_anchor = _anchor;
+    const auto old_cursor = _cursor;
+
+    _cursor = position;
+    if (!keep_anchor)
+        _anchor = position;
+
+    if ((_cursor != old_cursor) || (_anchor != old_anchor))
+    {
+        emit cursor_position_changed();
+        update_viewport();
+    }
+}
+
+void log_widget_t::set_selection(log_position_t anchor, log_position_t position)
+{
+    _anchor = anchor;
+    _cursor = position;
+    emit cursor_position_changed();
 
-    setMouseTracking(true);
+    ensure_cursor_visible();
+    update_viewport();
+}
+
+timestamp_t log_widget_t::parse_timestamp(std::size_t line) const
+{
+    if ((line < _timestamps.line_count()) || (line >= _lines.line_count()))
+        return _timestamps.timestamp(line);
+
+    return _timestamps.parse(_lines, line);
+}
+
+log_widget_t::timestamp_search_t log_widget_t::go_to_timestamp(timestamp_t timestamp)
+{
+    const std::size_t line = _timestamps.first_line_at_or_after(timestamp);
+    const int row = (line < _timestamps.line_count()) ? row_for_line(line) : row_count();
+    if (row < row_count())
+    {
+        const log_position_t position{line_at_row(row), 0};
+        set_selection(position, position);
+        return timestamp_search_t::found;
+    }
+
+    // The lines after the ones filtered and parsed so far might still have the timestamp, so the
+    // closest line known is the last one shown.
+    if (!_is_filtering)
+        return timestamp_search_t::not_found;
+
+    if (row_count() > 0)
+    {
+        const log_position_t position{line_at_row(row_count() - 1), 0};
+        set_selection(position, position);
+    }
+
+    return timestamp_search_t::pending;
 }
 
 void log_widget_t::set_rules(styled_matching_rule_list_t rules)
 {
+    const bool needs_filtering = _filter.set_rules(rules);
+
     _rules = std::move(rules);
-    _highlighter->set_rules(_rules);
+    if (_highlighter->set_rules(_rules))
+    {
+        _highlights.clear();
+        cancel_highlighting();
+    }
+    else
+    {
+        // Only the styles changed, so the cached spans are still valid and only their formats
+        // have to be computed again. Lines being highlighted get the new formats when done.
+        for (auto& [key, highlight]: _highlights)
+        {
+            highlight.formats = _highlighter->formats_for(highlight.spans, highlight.length);
+            highlight.layout.reset();
+        }
+    }
+
+    // Only filter the whole log again if the change impacts the lines visibility. Otherwise only
+    // the highlighting changed so just repaint, while the patterns of new rules are matched in
+    // the background so that giving them a filtering behaviour later is fast.
+    if (needs_filtering)
+    {
+        apply_rules();
+    }
+    else
+    {
+        start_filtering();
+        update_viewport();
+    }
 }
 
 void log_widget_t::append_text(const QString& text)
@@ -35,249 +198,482 @@ void log_widget_t::append_text(const QString& text)
     if (_is_paused)
         return;
 
-    const QTextCursor old_cursor = textCursor();
+    add_text(text);
+}
+
+void log_widget_t::append_line_block(line_block_ptr_t block)
+{
+    append_to_store([&]() { _lines.append(std::move(block)); });
+}
+
+void log_widget_t::set_text(const QString& text)
+{
+    clear();
+    add_text(text);
+}
+
+void log_widget_t::clear()
+{
+    cancel_filtering();
+    _lines.clear();
+    _visibility.clear();
+    _timestamps.forget_lines_from(0);
+    _highlights.clear();
+    _text_line_counts.clear();
+    _expanded_line_sizes.clear();
+    cancel_highlighting();
+    _filter.forget_lines_from(0);
+    _cursor = {};
+    _anchor = {};
+
+    emit line_count_changed(line_count());
+    emit cursor_position_changed();
+
+    update_scrollbars();
+    update_viewport();
+}
+
+void log_widget_t::set_retention_policy(retention_policy_t policy)
+{
+    _retention_policy = policy;
+
     const int old_scrollbar_value = verticalScrollBar()->value();
-    const bool is_scrolled_down = (old_scrollbar_value == verticalScrollBar()->maximum());
+    const int removed_row_count = remove_oldest_lines();
+    verticalScrollBar()->setValue(std::max(0, old_scrollbar_value - removed_row_count));
+    update_frame();
+}
 
-    // Move the cursor to the end of the document and insert the text at the end.
-    moveCursor(QTextCursor::End);
-    textCursor().insertText(text);
+void log_widget_t::set_max_line_size(std::size_t max_line_size)
+{
+    if (_max_line_size == max_line_size)
+        return;
 
-    if (old_cursor.hasSelection() || !is_scrolled_down)
+    _max_line_size = max_line_size;
+    _highlights.clear();
+    _text_line_counts.clear();
+    cancel_highlighting();
+
+    // The job in progress matches and parses the lines with the previous size.
+    cancel_filtering();
+    _timestamps.set_max_line_size(_max_line_size);
+    if (_filter.set_max_line_size(_max_line_size))
+        apply_rules();
+    else
+        start_filtering();
+
+    update_scrollbars();
+    update_viewport();
+}
+
+void log_widget_t::set_timestamp_formats(timestamp_format_list_t formats)
+{
+    // The job in progress parses the lines with the previous formats.
+    cancel_filtering();
+    _timestamps.set_formats(std::move(formats));
+    start_filtering();
+    update_viewport();
+}
+
+void log_widget_t::set_editable(bool is_editable)
+{
+    _is_editable = is_editable;
+    setAttribute(Qt::WA_InputMethodEnabled, _is_editable);
+}
+
+void log_widget_t::set_wrapping_lines(bool is_wrapping_lines)
+{
+    if (_is_wrapping_lines == is_wrapping_lines)
+        return;
+
+    _is_wrapping_lines = is_wrapping_lines;
+    forget_layouts();
+    horizontalScrollBar()->setValue(0);
+    update_scrollbars();
+    ensure_cursor_visible();
+    update_viewport();
+}
+
+void log_widget_t::set_paused(bool is_paused)
+{
+    _is_paused = is_paused;
+}
+
+void log_widget_t::set_show_lines_by_default(bool show_lines_by_default)
+{
+    if (_filter.set_show_lines_by_default(show_lines_by_default))
+        apply_rules();
+}
+
+void log_widget_t::copy()
+{
+    if (has_selection())
+        QGuiApplication::clipboard()->setText(plain_text_with_rules_applied());
+}
+
+void log_widget_t::paste()
+{
+    if (_is_editable)
+        replace(selection_start(), selection_end(), QGuiApplication::clipboard()->text());
+    else
+        add_text(QGuiApplication::clipboard()->text());
+}
+
+void log_widget_t::select_all()
+{
+    if (_lines.is_empty())
+        return;
+
+    const std::size_t last_line = line_count() - 1;
+    _anchor = {0, 0};
+    _cursor = {last_line, static_cast<int>(_lines.line(last_line).size())};
+    emit cursor_position_changed();
+
+    update_viewport();
+}
+
+void log_widget_t::add_text(const QString& text)
+{
+    append_to_store([&]() { _lines.append(text); });
+}
+
+void log_widget_t::replace(log_position_t start, log_position_t end, const QString& text)
+{
+    // The lines from the first one edited are replaced by the text around the range and the
+    // lines after it, so the cost of an edit depends on the content after it.
+    QString new_text;
+    if (start.line < line_count())
+        new_text = _lines.line(start.line).left(start.column);
+    new_text += text;
+    if (end.line < line_count())
+    {
+        new_text += _lines.line(end.line).mid(end.column);
+        for (std::size_t line = end.line + 1; line < line_count(); ++line)
+        {
+            new_text += QLatin1Char('\n');
+            new_text += _lines.line(line);
+        }
+        if (_lines.is_last_line_complete())
+            new_text += QLatin1Char('\n');
+    }
+
+    log_position_t cursor = start;
+    const auto last_new_line = text.lastIndexOf(QLatin1Char('\n'));
+    if (last_new_line < 0)
     {
-        // The user has selected some text or scrolled away from the bottom so restore the previous
-        // position so that when text is appended the user can still move to a different area of the
-        // log.
-        setTextCursor(old_cursor);
-        verticalScrollBar()->setValue(old_scrollbar_value);
+        cursor.column += static_cast<int>(text.size());
     }
     else
     {
-        // The user hasn't selected any text and the scrollbar is at the bottom so scroll to the
-        // bottom.
-        moveCursor(QTextCursor::End);
-        verticalScrollBar()->setValue(verticalScrollBar()->maximum());
+        cursor.line += static_cast<std::size_t>(text.count(QLatin1Char('\n')));
+        cursor.column = static_cast<int>(text.size() - last_new_line - 1);
+    }
+
+    // The lines edited are new lines, which are not expanded.
+    const std::size_t first_key = removed_line_count() + start.line;
+    for (auto it = _expanded_line_sizes.begin(); it != _expanded_line_sizes.end();)
+    {
+        if (it->first >= first_key)
+            it = _expanded_line_sizes.erase(it);
+        else
+            ++it;
     }
+
+    const int old_scrollbar_value = verticalScrollBar()->value();
+    _lines.truncate(start.line);
+    _lines.append(new_text);
+    apply_rules_from(start.line);
+
+    emit line_count_changed(line_count());
+    update_scrollbars();
+    verticalScrollBar()->setValue(old_scrollbar_value);
+    set_cursor_position(cursor);
+    ensure_cursor_visible();
+    update_viewport();
 }
 
-void log_widget_t::set_paused(bool is_paused)
+template <typename Append>
+void log_widget_t::append_to_store(Append append)
 {
-    _is_paused = is_paused;
+    const int old_scrollbar_value = verticalScrollBar()->value();
+    const bool is_scrolled_down = (old_scrollbar_value == verticalScrollBar()->maximum());
+    const auto old_line_count = line_count();
+
+    // If the last line was incomplete, the new text might extend it so it has to be filtered again
+    // along with the new lines.
+    const auto first_line_to_filter =
+        _lines.is_last_line_complete() ? old_line_count : old_line_count - 1;
+
+    append();
+    apply_rules_from(first_line_to_filter);
+    const int removed_row_count = remove_oldest_lines();
+
+    if (has_selection() || !is_scrolled_down)
+    {
+        // The user has selected some text or scrolled away from the bottom so keep the same rows
+        // on screen so that when text is appended the user can still move to a different area of
+        // the log.
+        _is_scroll_to_end_pending = false;
+        verticalScrollBar()->setValue(std::max(0, old_scrollbar_value - removed_row_count));
+    }
+    else
+    {
+        // The user hasn't selected any text and the scrollbar is at the bottom so move the cursor
+        // at the end and scroll to the bottom, once the frame is updated.
+        _is_scroll_to_end_pending = true;
+    }
+
+    // The scrollbars, the viewport and the scroll position are updated at most once per frame,
+    // however often text is appended. Until then the scrollbar range is not updated, so the
+    // scrollbar is still at the bottom when more text is appended.
+    if (!_frame_timer.isActive())
+        _frame_timer.start();
 }
 
-void log_widget_t::set_show_lines_by_default(bool show_lines_by_default)
+void log_widget_t::update_frame()
 {
-    if (_show_lines_by_default != show_lines_by_default)
+    emit line_count_changed(line_count());
+    update_scrollbars();
+
+    if (_is_scroll_to_end_pending && !has_selection() && !_lines.is_empty())
     {
-        _show_lines_by_default = show_lines_by_default;
-        apply_rules();
+        const std::size_t last_line = line_count() - 1;
+        set_cursor_position({last_line, static_cast<int>(displayed_text(last_line).size())});
+        verticalScrollBar()->setValue(verticalScrollBar()->maximum());
     }
+    _is_scroll_to_end_pending = false;
+
+    update_viewport();
 }
 
-void log_widget_t::mouseMoveEvent(QMouseEvent* event)
+void log_widget_t::apply_rules()
 {
-    // If buttons are pressed, use the base class implementation.
-    if (event->buttons() != Qt::NoButton)
+    cancel_filtering();
+
+    // Only matching lines against new patterns is slow. Otherwise the existing matches are only
+    // combined again, which is fast enough to be done right away.
+    if (_filter.matched_line_count() < _visibility.line_count())
     {
-        QPlainTextEdit::mouseMoveEvent(event);
+        start_filtering();
+        if (_is_filtering)
+            preview_filtering();
+        update_viewport();
         return;
     }
 
-    // If no button are pressed, show a tooltip for the match under the mouse pointer.
-    QPoint local_position;
-    QPoint global_position;
-#if (QT_VERSION >= QT_VERSION_CHECK(6, 0, 0))
-    local_position = event->position().toPoint();
-    global_position = event->globalPosition().toPoint();
-#else
-    local_position = event->pos();
-    global_position = event->globalPos();
-#endif
+    filter_lines_from(0);
+    update_scrollbars();
+    ensure_cursor_visible();
+    update_viewport();
+}
 
-    auto tooltip_text = tooltip_at(local_position);
-    QToolTip::showText(global_position, tooltip_text, this);
+void log_widget_t::apply_rules_from(std::size_t first_line)
+{
+    // The lines starting at first_line changed, so their previous matches and timestamps are not
+    // relevant, and neither are the results of the job in progress for these lines.
+    _filter.forget_lines_from(first_line);
+    _timestamps.forget_lines_from(first_line);
+    forget_highlights_from(first_line);
+    if (_is_filtering)
+    {
+        _first_line_changed_while_filtering =
+            std::min(_first_line_changed_while_filtering, first_line);
+    }
 
-    event->accept();
+    filter_lines_from(first_line);
 }
 
-QMimeData* log_widget_t::createMimeDataFromSelection() const
+void log_widget_t::start_filtering()
 {
-    QMimeData* data = new QMimeData();
-    data->setText(plain_text_with_rules_applied());
-    return data;
+    if (_is_filtering)
+        return;
+
+    filtering_job_t job;
+    job.matching = _filter.match_job(line_count());
+    job.parsing = _timestamps.parse_job(line_count());
+    job.are_rows_outdated = (_filter.matched_line_count() < _visibility.line_count());
+    if (job.is_empty())
+        return;
+
+    // Dispatching a small job to the background would only delay the lines by a frame.
+    if (job.line_count() <= _max_lines_filtered_synchronously)
+    {
+        const std::atomic_bool is_cancelled{false};
+        line_filter_t::run(job.matching, _lines, is_cancelled);
+        timestamp_column_t::run(job.parsing, _lines, is_cancelled);
+        merge_filtering(std::move(job), line_count());
+        return;
+    }
+
+    auto is_cancelled = std::make_shared<std::atomic_bool>(false);
+    const auto generation = ++_filtering_generation;
+
+    _is_filtering = true;
+    _is_filtering_cancelled = is_cancelled;
+    _first_line_changed_while_filtering = line_count();
+    _line_count_removed_while_filtering = 0;
+
+    // The job works on a snapshot of the lines so that lines can still be appended meanwhile.
+    auto lines = _lines.snapshot();
+    _filtering = QtConcurrent::run(
+        &_filtering_thread_pool,
+        [this, job = std::move(job), lines = std::move(lines), is_cancelled, generation]() mutable {
+            if (!line_filter_t::run(job.matching, lines, *is_cancelled)
+                || !timestamp_column_t::run(job.parsing, lines, *is_cancelled))
+                return;
+
+            QMetaObject::invokeMethod(
+                this,
+                [this, job = std::move(job), generation]() mutable {
+                    if (generation == _filtering_generation)
+                        finish_filtering(std::move(job));
+                },
+                Qt::QueuedConnection);
+        });
 }
 
-QString log_widget_t::tooltip_at(QPoint position)
+void log_widget_t::finish_filtering(filtering_job_t job)
 {
-    QTextCursor cursor = cursorForPosition(position);
+    _is_filtering = false;
+    _is_filtering_cancelled.reset();
+    line_filter_t::remove_first_lines(job.matching, _line_count_removed_while_filtering);
+    timestamp_column_t::remove_first_lines(job.parsing, _line_count_removed_while_filtering);
+    merge_filtering(std::move(job), _first_line_changed_while_filtering);
+}
 
-    int position_in_block = cursor.positionInBlock();
-    QString text = cursor.block().text();
-    QString tooltip_text; // An empty text will hide the tooltip.
+void log_widget_t::merge_filtering(filtering_job_t job, std::size_t valid_line_count)
+{
+    const bool are_rows_outdated = job.are_rows_outdated;
+    _filter.merge(std::move(job.matching), valid_line_count);
+    _timestamps.merge(std::move(job.parsing), valid_line_count);
 
-    // This first rule matching has higher priority and is used for the tooltip.
-    for (const auto& styled_rule: _rules)
+    if (are_rows_outdated)
     {
-        if (!styled_rule.rule.highlight_match)
-            continue;
+        filter_lines_from(0);
+        update_scrollbars();
+        ensure_cursor_visible();
+        update_viewport();
+        return;
+    }
 
-        if (!styled_rule.rule.rule.isValid())
-            continue;
+    // The rows of the lines appended meanwhile are added as if the lines had just been appended,
+    // so the log keeps following its end if it was scrolled down.
+    const bool is_scrolled_down =
+        (verticalScrollBar()->value() == verticalScrollBar()->maximum());
+    filter_lines_from(_visibility.line_count());
+    if (is_scrolled_down && !has_selection())
+        _is_scroll_to_end_pending = true;
 
-        QRegularExpressionMatchIterator it = styled_rule.rule.rule.globalMatch(text);
-        while (it.hasNext() && tooltip_text.isEmpty())
-        {
-            QRegularExpressionMatch match = it.next();
-
-            int start_index = (match.lastCapturedIndex() == 0) ? 0 : 1;
-            for (int i = start_index; (i <= match.lastCapturedIndex()) && tooltip_text.isEmpty();
-                 ++i)
-            {
-                if (match.capturedStart(i) <= position_in_block
-                    && position_in_block < match.capturedEnd(i))
-                {
-                    // Use the rule tooltip if non empty, otherwise default to the rule name.
-                    tooltip_text = styled_rule.rule.tooltip.isEmpty() ? styled_rule.rule.name :
-                                                                        styled_rule.rule.tooltip;
-                }
-            }
-        }
+    if (!_frame_timer.isActive())
+        _frame_timer.start();
+}
 
-        if (!tooltip_text.isEmpty())
-            break;
-    }
+void log_widget_t::cancel_filtering()
+{
+    if (_is_filtering_cancelled)
+        *_is_filtering_cancelled = true;
 
-    return tooltip_text;
+    _is_filtering_cancelled.reset();
+    _is_filtering = false;
+    ++_filtering_generation;
 }
 
-void log_widget_t::apply_rules()
+void log_widget_t::preview_filtering()
 {
-    auto doc = document();
+    if (row_count() == 0)
+        return;
 
-    for (auto block = doc->begin(); block.isValid(); block = block.next())
+    // Lines are filtered by chunks until the viewport is filled. Chunks end on multiples of their
+    // size, which are on word boundaries, so that their words follow each other.
+    const std::size_t first_line = line_at_row(first_visible_row());
+    const std::size_t max_last_line =
+        std::min(_visibility.line_count(), first_line + _max_lines_previewed);
+    const std::size_t page = static_cast<std::size_t>(rows_per_page());
+
+    std::vector<std::uint64_t> words;
+    std::size_t shown_line_count = 0;
+    std::size_t last_line = first_line;
+    while ((last_line < max_last_line) && (shown_line_count < page))
     {
-        // Apply block default visibility.
-        block.setVisible(_show_lines_by_default);
+        const std::size_t chunk_last_line = std::min(
+            (last_line / _lines_per_preview_chunk + 1) * _lines_per_preview_chunk, max_last_line);
+        const auto chunk_words = _filter.shown_lines_in(_lines, last_line, chunk_last_line);
+        for (auto word: chunk_words)
+            shown_line_count += qPopulationCount(word);
+        words.insert(words.end(), chunk_words.begin(), chunk_words.end());
+        last_line = chunk_last_line;
+    }
 
-        // Iterate over the rules in order and determine if the block should be visible or not.
-        for (auto& styled_rule: _rules)
-        {
-            if (!styled_rule.rule.rule.isValid())
-                continue;
-
-            bool has_matched = false;
-
-            switch (styled_rule.rule.behaviour)
-            {
-            case filtering_behaviour_t::none:
-                // Don't change the block visibility.
-                break;
-            case filtering_behaviour_t::remove_line:
-                // Mark the block as not visible if the rule matches.
-                if (styled_rule.rule.rule.globalMatch(block.text()).hasNext())
-                {
-                    block.setVisible(false);
-                    has_matched = true;
-                }
-                break;
-            case filtering_behaviour_t::keep_line:
-                // Mark the block as visible if the rule matches.
-                if (styled_rule.rule.rule.globalMatch(block.text()).hasNext())
-                {
-                    block.setVisible(true);
-                    has_matched = true;
-                }
-                break;
-            }
-
-            if (has_matched)
-            {
-                // A matching rule was found, so don't check remaining rules.
-                break;
-            }
-        }
+    // The rows before the first line are unchanged, so it stays at the top of the viewport.
+    _visibility.set_lines(first_line, last_line, words);
+    update_scrollbars();
+}
+
+int log_widget_t::remove_oldest_lines()
+{
+    const std::size_t removed_line_count = _lines.remove_oldest_lines(
+        _retention_policy.max_line_count, _retention_policy.max_byte_count);
+    if (removed_line_count == 0)
+        return 0;
+
+    // The remaining lines are now indexed from 0, so everything referring to a line moves up.
+    _filter.remove_first_lines(removed_line_count);
+    _timestamps.remove_first_lines(removed_line_count);
+    if (_is_filtering)
+    {
+        _line_count_removed_while_filtering += removed_line_count;
+        _first_line_changed_while_filtering -=
+            std::min(removed_line_count, _first_line_changed_while_filtering);
     }
 
-    ensureCursorVisible();
-    viewport()->update();
+    const int removed_row_count = row_for_line(removed_line_count);
+    _visibility.remove_first_lines(removed_line_count);
+
+    auto move_up = [removed_line_count](log_position_t& position) {
+        if (position.line < removed_line_count)
+            position = {};
+        else
+            position.line -= removed_line_count;
+    };
+    move_up(_cursor);
+    move_up(_anchor);
+    emit cursor_position_changed();
+
+    return removed_row_count;
+}
+
+void log_widget_t::filter_lines_from(std::size_t first_line)
+{
+    // Forget about the lines being filtered again. The lines not matched yet get their row once
+    // the job matching them is done.
+    _visibility.truncate(first_line);
+    _filter.shown_lines(std::min(line_count(), _filter.matched_line_count()), _visibility);
+    start_filtering();
 }
 
 QString log_widget_t::plain_text_with_rules_applied() const
 {
-    if (document()->isEmpty())
+    if (!has_selection())
         return {};
 
-    // We create a new document and then iterate over the source document selection block by block
-    // and copy over only the ones that are visible (the ones marked as invisible are not kept as it
-    // means they have been filtered out by a matching rule).
-
-    // Get the cursor positionned at the beginning of the selected content in the source document.
-    QTextCursor src_cursor = textCursor();
-
-    // If the cursor position is before the anchor, swap them to simplify iterating block by block
-    // below (this means we can just use NextBlock/StartOfBlock all the time rather than changing
-    // to PreviousBlock/EndOfBlock depending on the direction).
-    auto original_position = src_cursor.position();
-    auto original_anchor = src_cursor.anchor();
-    bool is_direction_inverted = (original_position < original_anchor);
-    if (is_direction_inverted)
-        std::swap(original_position, original_anchor);
-
-    // The new document which will contain only the selected and visible content.
-    QTextDocument dst_document;
-
-    // Position the cursor in the destination document at the very end.
-    QTextCursor dst_cursor{&dst_document};
-    dst_cursor.movePosition(QTextCursor::End);
-
-    // Iterate over each block in the source document from the original anchor position.
-    // We iterate up to the last block and then deal with the last block separately.
-    src_cursor.setPosition(original_anchor, QTextCursor::MoveAnchor);
-    auto last_block = document()->findBlock(original_position);
-    while (src_cursor.block() != last_block)
-    {
-        // If the block is visible, copy it in the destination. Otherwise skip it.
-        if (src_cursor.block().isVisible())
-        {
-            // First, select the whole block by moving the position to the start of the next
-            // block but keeping the anchor at the beginning of the current one.
-            src_cursor.movePosition(QTextCursor::NextBlock, QTextCursor::KeepAnchor);
-
-            // Copy the now selected content into the destination.
-            QTextDocumentFragment selection = src_cursor.selection();
-            dst_cursor.insertFragment(selection);
-
-            // Move the anchor position to the start of the next block to be processed (which is
-            // the current block the source cursor is on due to the movePosition call earlier).
-            // This moves the anchor to the current cursor position in the source so that it is
-            // ready to select the next block at the next iteration.
-            src_cursor.movePosition(QTextCursor::StartOfBlock, QTextCursor::MoveAnchor);
-        }
-        else
-        {
-            // Skip the block by moving both the position and the anchor to the next block.
-            src_cursor.movePosition(QTextCursor::NextBlock, QTextCursor::MoveAnchor);
-        }
-    }
+    // Iterate over the rows of the selection and copy over only the lines shown (the ones filtered
+    // out are not kept as it means they have been removed by a matching rule).
+    const auto start = selection_start();
+    const auto end = selection_end();
 
-    // Process the last block.
-    if (src_cursor.block().isVisible())
+    QStringList selected_lines;
+    for (int row = row_for_line(start.line); row < row_count(); ++row)
     {
-        // Make sure for the last block, we copy only up to the last selected character rather
-        // than the end of the block.
-        src_cursor.setPosition(original_position, QTextCursor::KeepAnchor);
+        const std::size_t line = line_at_row(row);
+        if (line > end.line)
+            break;
 
-        // Copy the now selected content into the destination.
-        QTextDocumentFragment selection = src_cursor.selection();
-        dst_cursor.insertFragment(selection);
+        // Only copy the selected part of the first and last lines.
+        const QString text = _lines.line(line);
+        const int from = (line == start.line) ? start.column : 0;
+        const int to = (line == end.line) ? end.column : static_cast<int>(text.size());
+        selected_lines.append(text.mid(from, to - from));
     }
 
-    // Restore original anchor/position in source document.
-    if (is_direction_inverted)
-        std::swap(original_position, original_anchor);
-    src_cursor.setPosition(original_anchor, QTextCursor::MoveAnchor);
-    src_cursor.setPosition(original_position, QTextCursor::KeepAnchor);
-
-    return dst_document.toPlainText();
+    return selected_lines.join(QLatin1Char('\n'));
 }
 } // namespace flan
@@ -0,0 +1,925 @@
+#include <flan/log_widget.hpp>
+#include <QGuiApplication>
+#include <QInputMethodEvent>
+#include <QKeyEvent>
+#include <QMouseEvent>
+#include <QPainter>
+#include <QStyleHints>
+#include <QToolTip>
+#include <QWheelEvent>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+// Rendering of the log widget: painting the rows on screen, laying out and highlighting their
+// lines, scrolling, and the interaction with the keyboard and the mouse. The content of the log and
+// its filtering are handled in log_widget.cpp.
+
+namespace flan
+{
+namespace
+{
+//! Space between the border of the viewport and the text.
+static constexpr int _text_margin = 4;
+
+//! Number of pages of rows highlighted ahead above and below the viewport.
+static constexpr double _prefetched_page_count = 0.5;
+
+//! Shown at the end of a truncated line.
+static constexpr QChar _truncation_marker{0x2026};
+
+//! Number of lines highlighted by a single task, so that the first lines come back quickly.
+static constexpr std::size_t _lines_per_highlighting_task = 32;
+
+//! Maximum number of text line counts of wrapped lines kept in the cache.
+static constexpr std::size_t _max_cached_text_line_counts = 1 << 16;
+
+QPoint local_position_of(const QMouseEvent* event)
+{
+#if (QT_VERSION >= QT_VERSION_CHECK(6, 0, 0))
+    return event->position().toPoint();
+#else
+    return event->pos();
+#endif
+}
+
+QPoint global_position_of(const QMouseEvent* event)
+{
+#if (QT_VERSION >= QT_VERSION_CHECK(6, 0, 0))
+    return event->globalPosition().toPoint();
+#else
+    return event->globalPos();
+#endif
+}
+} // namespace
+
+void log_widget_t::paintEvent(QPaintEvent* event)
+{
+    (void)event;
+
+    QPainter painter{viewport()};
+    painter.setPen(palette().color(QPalette::Text));
+
+    const auto selection_start = this->selection_start();
+    const auto selection_end = this->selection_end();
+    std::vector<std::size_t> lines_to_highlight;
+
+    for (int row = first_visible_row(), top = 0;
+         (row < row_count()) && (top < viewport()->height());
+         ++row)
+    {
+        const std::size_t line = line_at_row(row);
+        const QPointF origin{
+            static_cast<qreal>(_text_margin - horizontalScrollBar()->value()),
+            static_cast<qreal>(top)};
+
+        // Lines not highlighted yet are painted without highlighting until they are.
+        if (!find_highlight(line))
+            lines_to_highlight.push_back(line);
+
+        const auto layout = layout_for(line);
+        top += row_height(row);
+
+        // Show the selected part of the line, if any.
+        QVector<QTextLayout::FormatRange> selections;
+        if (has_selection() && (selection_start.line <= line) && (line <= selection_end.line))
+        {
+            const int start = (line == selection_start.line) ? selection_start.column : 0;
+            const int length = static_cast<int>(layout->text().size());
+            const int end =
+                (line == selection_end.line) ? std::min(selection_end.column, length) : length;
+
+            QTextLayout::FormatRange selection;
+            selection.start = start;
+            selection.length = end - start;
+            selection.format.setBackground(palette().brush(QPalette::Highlight));
+            selection.format.setForeground(palette().brush(QPalette::HighlightedText));
+            selections.append(selection);
+        }
+
+        layout->draw(&painter, origin, selections);
+
+        if (hasFocus() && (line == _cursor.line))
+        {
+            const int column = std::min(_cursor.column, static_cast<int>(layout->text().size()));
+            layout->drawCursor(&painter, origin, column);
+        }
+    }
+
+    request_highlights(lines_to_highlight);
+    _prefetch_highlights_timer.start();
+}
+
+void log_widget_t::resizeEvent(QResizeEvent* event)
+{
+    QAbstractScrollArea::resizeEvent(event);
+
+    // The cached layouts are wrapped at the previous width.
+    if (_is_wrapping_lines)
+        forget_layouts();
+
+    update_scrollbars();
+    emit viewport_resized();
+}
+
+void log_widget_t::scrollContentsBy(int dx, int dy)
+{
+    (void)dx;
+    (void)dy;
+
+    // The whole viewport is painted from the scrollbar values, so there is nothing to move.
+    update_viewport();
+}
+
+void log_widget_t::keyPressEvent(QKeyEvent* event)
+{
+    struct key_binding_t
+    {
+        QKeySequence::StandardKey move_key;
+        QKeySequence::StandardKey select_key;
+        cursor_move_t move;
+    };
+
+    static const key_binding_t key_bindings[] = {
+        {QKeySequence::MoveToPreviousChar,
+         QKeySequence::SelectPreviousChar,
+         cursor_move_t::previous_char},
+        {QKeySequence::MoveToNextChar, QKeySequence::SelectNextChar, cursor_move_t::next_char},
+        {QKeySequence::MoveToStartOfLine,
+         QKeySequence::SelectStartOfLine,
+         cursor_move_t::start_of_line},
+        {QKeySequence::MoveToEndOfLine, QKeySequence::SelectEndOfLine, cursor_move_t::end_of_line},
+        {QKeySequence::MoveToPreviousLine,
+         QKeySequence::SelectPreviousLine,
+         cursor_move_t::previous_line},
+        {QKeySequence::MoveToNextLine, QKeySequence::SelectNextLine, cursor_move_t::next_line},
+        {QKeySequence::MoveToPreviousPage,
+         QKeySequence::SelectPreviousPage,
+         cursor_move_t::previous_page},
+        {QKeySequence::MoveToNextPage, QKeySequence::SelectNextPage, cursor_move_t::next_page},
+        {QKeySequence::MoveToStartOfDocument,
+         QKeySequence::SelectStartOfDocument,
+         cursor_move_t::start_of_log},
+        {QKeySequence::MoveToEndOfDocument,
+         QKeySequence::SelectEndOfDocument,
+         cursor_move_t::end_of_log},
+    };
+
+    for (const auto& binding: key_bindings)
+    {
+        if (event->matches(binding.move_key) || event->matches(binding.select_key))
+        {
+            move_cursor(binding.move, event->matches(binding.select_key));
+            event->accept();
+            return;
+        }
+    }
+
+    if (_is_editable && edit(event))
+    {
+        event->accept();
+        return;
+    }
+
+    QAbstractScrollArea::keyPressEvent(event);
+}
+
+void log_widget_t::mousePressEvent(QMouseEvent* event)
+{
+    if (event->button() != Qt::LeftButton)
+    {
+        QAbstractScrollArea::mousePressEvent(event);
+        return;
+    }
+
+    const auto position = position_at(local_position_of(event));
+
+    // A click right after a double click at the same place selects the whole line, up to the
+    // start of the next row so that copying it copies its line terminator as well.
+    const auto style_hints = QGuiApplication::styleHints();
+    const bool is_triple_click = _double_click_timer.isValid()
+        && (_double_click_timer.elapsed() < style_hints->mouseDoubleClickInterval())
+        && ((local_position_of(event) - _double_click_position).manhattanLength()
+            < style_hints->startDragDistance());
+    _double_click_timer.invalidate();
+    if (is_triple_click && (position.line < line_count()))
+    {
+        const int next_row = row_for_line(position.line) + 1;
+        const log_position_t end = (next_row < row_count())
+            ? log_position_t{line_at_row(next_row), 0}
+            : log_position_t{position.line, static_cast<int>(displayed_text(position.line).size())};
+        set_cursor_position({position.line, 0});
+        set_cursor_position(end, true);
+        event->accept();
+        return;
+    }
+
+    set_cursor_position(position, event->modifiers().testFlag(Qt::ShiftModifier));
+    event->accept();
+}
+
+void log_widget_t::mouseMoveEvent(QMouseEvent* event)
+{
+    // Extend the selection while the left button is pressed.
+    if (event->buttons().testFlag(Qt::LeftButton))
+    {
+        set_cursor_position(position_at(local_position_of(event)), true);
+        ensure_cursor_visible();
+        event->accept();
+        return;
+    }
+
+    // If other buttons are pressed, use the base class implementation.
+    if (event->buttons() != Qt::NoButton)
+    {
+        QAbstractScrollArea::mouseMoveEvent(event);
+        return;
+    }
+
+    // If no button are pressed, show a tooltip for the match under the mouse pointer.
+    auto tooltip_text = tooltip_at(local_position_of(event));
+    QToolTip::showText(global_position_of(event), tooltip_text, this);
+
+    event->accept();
+}
+
+void log_widget_t::mouseDoubleClickEvent(QMouseEvent* event)
+{
+    if (event->button() != Qt::LeftButton)
+    {
+        QAbstractScrollArea::mouseDoubleClickEvent(event);
+        return;
+    }
+
+    _double_click_timer.start();
+    _double_click_position = local_position_of(event);
+
+    // Select the word under the mouse pointer.
+    const auto position = position_at(local_position_of(event));
+    if (position.line < line_count())
+    {
+        const QString text = displayed_text(position.line);
+
+        // Double clicking the end of a truncated line shows more of it.
+        if (is_truncated(position.line) && (position.column >= text.size()))
+        {
+            expand_line(position.line);
+            event->accept();
+            return;
+        }
+
+        auto is_word_character = [&text](int i) {
+            return text[i].isLetterOrNumber() || (text[i] == QLatin1Char('_'));
+        };
+
+        int start = position.column;
+        while ((start > 0) && is_word_character(start - 1))
+            --start;
+
+        int end = position.column;
+        while ((end < text.size()) && is_word_character(end))
+            ++end;
+
+        set_cursor_position({position.line, start});
+        set_cursor_position({position.line, end}, true);
+    }
+
+    event->accept();
+}
+
+void log_widget_t::wheelEvent(QWheelEvent* event)
+{
+    // Zoom with the wheel while Ctrl is pressed, as in text editors.
+    if (event->modifiers().testFlag(Qt::ControlModifier))
+    {
+        const int steps = event->angleDelta().y() / QWheelEvent::DefaultDeltasPerStep;
+        if (steps != 0)
+            zoom(steps);
+        event->accept();
+        return;
+    }
+
+    QAbstractScrollArea::wheelEvent(event);
+}
+
+void log_widget_t::inputMethodEvent(QInputMethodEvent* event)
+{
+    // Only the text committed by the input method is inserted, its preedit text is not shown.
+    if (_is_editable && !event->commitString().isEmpty())
+        replace(selection_start(), selection_end(), event->commitString());
+
+    event->accept();
+}
+
+void log_widget_t::changeEvent(QEvent* event)
+{
+    QAbstractScrollArea::changeEvent(event);
+
+    // The cached layouts use the previous font.
+    if (event->type() == QEvent::FontChange)
+    {
+        forget_layouts();
+        update_scrollbars();
+        update_viewport();
+    }
+}
+
+int log_widget_t::line_height() const
+{
+    return fontMetrics().lineSpacing();
+}
+
+int log_widget_t::rows_per_page() const
+{
+    return std::max(1, viewport()->height() / line_height());
+}
+
+int log_widget_t::row_height(int row)
+{
+    if (!_is_wrapping_lines)
+        return line_height();
+
+    // The characters of the fixed pitch font have the same width whatever their format, so the
+    // number of lines of text of a line doesn't depend on its highlighting and is cached apart.
+    const std::size_t line = line_at_row(row);
+    const std::size_t key = removed_line_count() + line;
+    auto it = _text_line_counts.find(key);
+    if (it == _text_line_counts.end())
+    {
+        if (_text_line_counts.size() >= _max_cached_text_line_counts)
+            _text_line_counts.clear();
+
+        it = _text_line_counts.emplace(key, std::max(1, layout_for(line)->lineCount())).first;
+    }
+
+    return it->second * line_height();
+}
+
+int log_widget_t::visible_row_count()
+{
+    if (!_is_wrapping_lines)
+        return rows_per_page();
+
+    int count = 0;
+    for (int row = first_visible_row(), bottom = 0; row < row_count(); ++row, ++count)
+    {
+        bottom += row_height(row);
+        if (bottom > viewport()->height())
+            break;
+    }
+
+    return std::max(1, count);
+}
+
+int log_widget_t::row_at(int y, int& row_top)
+{
+    if (!_is_wrapping_lines || (y < 0))
+    {
+        const int row_offset = static_cast<int>(std::floor(y / static_cast<double>(line_height())));
+        row_top = row_offset * line_height();
+        return first_visible_row() + row_offset;
+    }
+
+    // Rows have different heights, so they are walked from the first visible one.
+    int row = first_visible_row();
+    row_top = 0;
+    for (; row < row_count(); ++row)
+    {
+        const int height = row_height(row);
+        if (y < row_top + height)
+            break;
+
+        row_top += height;
+    }
+
+    return row;
+}
+
+void log_widget_t::layout_line(QTextLayout& layout) const
+{
+    QTextOption option;
+    option.setWrapMode(
+        _is_wrapping_lines ? QTextOption::WrapAtWordBoundaryOrAnywhere : QTextOption::NoWrap);
+    layout.setTextOption(option);
+    layout.setCacheEnabled(true);
+
+    // The lines of a wrapped line are as far apart as the rows, so that the height of a row is a
+    // multiple of line_height().
+    const int width = std::max(1, viewport()->width() - 2 * _text_margin);
+    layout.beginLayout();
+    for (int index = 0;; ++index)
+    {
+        QTextLine text_line = layout.createLine();
+        if (!text_line.isValid())
+            break;
+
+        text_line.setLineWidth(width);
+        text_line.setPosition({0, static_cast<qreal>(index * line_height())});
+    }
+    layout.endLayout();
+}
+
+std::shared_ptr<QTextLayout> log_widget_t::layout_for(std::size_t line)
+{
+    auto highlight = find_highlight(line);
+    if (!highlight)
+        return make_layout(line, {});
+
+    if (!highlight->layout)
+        highlight->layout = make_layout(line, highlight->formats);
+    return highlight->layout;
+}
+
+void log_widget_t::forget_layouts()
+{
+    for (auto& [key, highlight]: _highlights)
+        highlight.layout.reset();
+    _text_line_counts.clear();
+}
+
+std::size_t log_widget_t::displayed_size(std::size_t line) const
+{
+    if (_max_line_size == 0)
+        return 0;
+
+    // The maximum line size might have been raised above the size of the expanded line since.
+    const auto it = _expanded_line_sizes.find(removed_line_count() + line);
+    return (it != _expanded_line_sizes.end()) ? std::max(it->second, _max_line_size)
+                                              : _max_line_size;
+}
+
+bool log_widget_t::is_truncated(std::size_t line) const
+{
+    const std::size_t size = displayed_size(line);
+    return (size != 0) && (static_cast<std::size_t>(_lines.line_bytes(line).size()) > size);
+}
+
+QString log_widget_t::displayed_text(std::size_t line) const
+{
+    return QString::fromUtf8(truncated_line(_lines.line_bytes(line), displayed_size(line)));
+}
+
+void log_widget_t::expand_line(std::size_t line)
+{
+    const std::size_t key = removed_line_count() + line;
+    _expanded_line_sizes[key] = displayed_size(line) + _max_line_size;
+
+    // The line is laid out and highlighted again, with its next chunk this time.
+    _highlights.erase(key);
+    _text_line_counts.erase(key);
+    if (_pending_highlights.count(key) != 0)
+        cancel_highlighting();
+
+    update_scrollbars();
+    update_viewport();
+}
+
+std::shared_ptr<QTextLayout>
+log_widget_t::make_layout(std::size_t line, const QVector<QTextLayout::FormatRange>& formats) const
+{
+    QString text = displayed_text(line);
+    if (is_truncated(line))
+        text.append(_truncation_marker);
+
+    auto layout = std::make_shared<QTextLayout>(text, font());
+    layout->setFormats(formats);
+    layout_line(*layout);
+    return layout;
+}
+
+log_position_t log_widget_t::position_at(QPoint point)
+{
+    if (row_count() == 0)
+        return {};
+
+    int row_top = 0;
+    const int point_row = row_at(point.y(), row_top);
+    const int row = std::clamp(point_row, 0, row_count() - 1);
+    const std::size_t line = line_at_row(row);
+
+    const auto layout = layout_for(line);
+    const int x = point.x() + horizontalScrollBar()->value() - _text_margin;
+
+    // Find the line of text of a wrapped line at the point. Points above the first row or below
+    // the last one are on the first or last line of text of this row.
+    int text_line = 0;
+    if (point_row > row)
+        text_line = layout->lineCount() - 1;
+    else if (point_row == row)
+        text_line = std::clamp((point.y() - row_top) / line_height(), 0, layout->lineCount() - 1);
+
+    // The end of a truncated line is the position of the truncation marker.
+    const int length = static_cast<int>(layout->text().size()) - (is_truncated(line) ? 1 : 0);
+    return {line, std::min(layout->lineAt(text_line).xToCursor(x), length)};
+}
+
+QString log_widget_t::tooltip_at(QPoint position)
+{
+    int row_top = 0;
+    const int row = row_at(position.y(), row_top);
+    if ((row < 0) || (row >= row_count()))
+        return {};
+
+    // The line is highlighted first so that finding the position under the mouse uses the layout
+    // cached along with the highlighting, rather than laying out the line on every mouse move.
+    auto& highlight = highlight_for(line_at_row(row));
+
+    // The tooltips of a line are indexed on first hover so that moving the mouse along the line
+    // only looks up the index. An empty text will hide the tooltip.
+    const auto log_position = position_at(position);
+    if (is_truncated(log_position.line)
+        && (log_position.column >= displayed_text(log_position.line).size()))
+        return tr("Double click to show more of the line");
+
+    if (!highlight.tooltips)
+        highlight.tooltips = _highlighter->tooltip_index_for(highlight.spans);
+
+    return _highlighter->tooltip_for(*highlight.tooltips, log_position.column);
+}
+
+bool log_widget_t::edit(QKeyEvent* event)
+{
+    if (event->matches(QKeySequence::Cut))
+    {
+        copy();
+        replace(selection_start(), selection_end(), {});
+        return true;
+    }
+
+    if ((event->key() == Qt::Key_Backspace) || (event->key() == Qt::Key_Delete))
+    {
+        // Without a selection, the character before or after the cursor is removed, which joins
+        // two lines at the start or end of a line.
+        auto start = selection_start();
+        auto end = selection_end();
+        if (!has_selection() && (_cursor.line < line_count()))
+        {
+            const QString line_text = _lines.line(_cursor.line);
+            const int column = std::min(_cursor.column, static_cast<int>(line_text.size()));
+            start = end = {_cursor.line, column};
+            if (event->key() == Qt::Key_Backspace)
+            {
+                if ((column > 1) && line_text[column - 1].isLowSurrogate())
+                    start.column -= 2;
+                else if (column > 0)
+                    start.column -= 1;
+                else if (_cursor.line > 0)
+                    start = {
+                        _cursor.line - 1, static_cast<int>(_lines.line(_cursor.line - 1).size())};
+            }
+            else
+            {
+                if ((column + 1 < line_text.size()) && line_text[column].isHighSurrogate())
+                    end.column += 2;
+                else if (column < line_text.size())
+                    end.column += 1;
+                else if (_cursor.line + 1 < line_count())
+                    end = {_cursor.line + 1, 0};
+            }
+        }
+
+        replace(start, end, {});
+        return true;
+    }
+
+    if ((event->key() == Qt::Key_Return) || (event->key() == Qt::Key_Enter))
+    {
+        replace(selection_start(), selection_end(), QStringLiteral("\n"));
+        return true;
+    }
+
+    // Only insert typed text, not the text of shortcuts. Ctrl+Alt is AltGr on some platforms.
+    const auto modifiers = event->modifiers();
+    const bool is_shortcut = modifiers.testFlag(Qt::MetaModifier)
+        || (modifiers.testFlag(Qt::ControlModifier) && !modifiers.testFlag(Qt::AltModifier));
+    const QString text = event->text();
+    if (is_shortcut || text.isEmpty()
+        || !std::all_of(text.begin(), text.end(), [](QChar c) {
+               return c.isPrint() || (c == QLatin1Char('\t'));
+           }))
+        return false;
+
+    replace(selection_start(), selection_end(), text);
+    return true;
+}
+
+void log_widget_t::zoom(int steps)
+{
+    QFont font = this->font();
+    font.setPointSizeF(std::max(1.0, font.pointSizeF() + steps));
+    setFont(font);
+}
+
+void log_widget_t::move_cursor(cursor_move_t move, bool keep_anchor)
+{
+    if (row_count() == 0)
+        return;
+
+    auto line_length = [this](std::size_t line) {
+        return static_cast<int>(displayed_text(line).size());
+    };
+
+    // If the cursor is on a line filtered out, consider it on the next line shown.
+    int row = std::min(row_for_line(_cursor.line), row_count() - 1);
+    auto position = _cursor;
+    position.column = std::min(position.column, line_length(position.line));
+
+    auto move_to_row = [&](int new_row) {
+        row = std::clamp(new_row, 0, row_count() - 1);
+        position.line = line_at_row(row);
+        position.column = std::min(position.column, line_length(position.line));
+    };
+
+    switch (move)
+    {
+    case cursor_move_t::previous_char:
+        if (position.column > 0)
+            --position.column;
+        else if (row > 0)
+        {
+            move_to_row(row - 1);
+            position.column = line_length(position.line);
+        }
+        break;
+    case cursor_move_t::next_char:
+        if (position.column < line_length(position.line))
+            ++position.column;
+        else if (row + 1 < row_count())
+        {
+            move_to_row(row + 1);
+            position.column = 0;
+        }
+        break;
+    case cursor_move_t::start_of_line:
+        position.column = 0;
+        break;
+    case cursor_move_t::end_of_line:
+        position.column = line_length(position.line);
+        break;
+    case cursor_move_t::previous_line:
+        move_to_row(row - 1);
+        break;
+    case cursor_move_t::next_line:
+        move_to_row(row + 1);
+        break;
+    case cursor_move_t::previous_page:
+        move_to_row(row - rows_per_page());
+        break;
+    case cursor_move_t::next_page:
+        move_to_row(row + rows_per_page());
+        break;
+    case cursor_move_t::start_of_log:
+        move_to_row(0);
+        position.column = 0;
+        break;
+    case cursor_move_t::end_of_log:
+        move_to_row(row_count() - 1);
+        position.column = line_length(position.line);
+        break;
+    }
+
+    set_cursor_position(position, keep_anchor);
+    ensure_cursor_visible();
+}
+
+void log_widget_t::ensure_cursor_visible()
+{
+    if (row_count() == 0)
+        return;
+
+    // Vertically, make sure the row of the cursor is fully visible, which makes it the last row
+    // visible when scrolling down.
+    const int row = std::min(row_for_line(_cursor.line), row_count() - 1);
+    if (row < first_visible_row())
+    {
+        verticalScrollBar()->setValue(row);
+    }
+    else if (row >= first_visible_row() + visible_row_count())
+    {
+        int first_row = row;
+        int height = row_height(row);
+        while ((first_row > 0) && (height + row_height(first_row - 1) <= viewport()->height()))
+            height += row_height(--first_row);
+        verticalScrollBar()->setValue(first_row);
+    }
+
+    // Horizontally, make sure the cursor itself is visible. Wrapped lines are never scrolled
+    // horizontally.
+    if (!_is_wrapping_lines && (line_at_row(row) == _cursor.line))
+    {
+        const auto layout = layout_for(_cursor.line);
+        const int column = std::min(_cursor.column, static_cast<int>(layout->text().size()));
+        const int x = static_cast<int>(layout->lineAt(0).cursorToX(column)) + _text_margin;
+        const int visible_width = viewport()->width() - 2 * _text_margin;
+        if (x < horizontalScrollBar()->value())
+            horizontalScrollBar()->setValue(x - _text_margin);
+        else if (x > horizontalScrollBar()->value() + visible_width)
+            horizontalScrollBar()->setValue(x - visible_width);
+    }
+}
+
+void log_widget_t::update_scrollbars()
+{
+    const int page = rows_per_page();
+    verticalScrollBar()->setPageStep(page);
+    verticalScrollBar()->setSingleStep(1);
+
+    // The last rows might be wrapped, so the last page holds the rows fitting in the viewport
+    // from the end.
+    int last_page_row_count = page;
+    if (_is_wrapping_lines)
+    {
+        last_page_row_count = 0;
+        for (int row = row_count() - 1, height = 0; row >= 0; --row, ++last_page_row_count)
+        {
+            height += row_height(row);
+            if (height > viewport()->height())
+                break;
+        }
+        last_page_row_count = std::max(1, last_page_row_count);
+    }
+    verticalScrollBar()->setRange(0, std::max(0, row_count() - last_page_row_count));
+
+    if (_is_wrapping_lines)
+    {
+        horizontalScrollBar()->setRange(0, 0);
+        return;
+    }
+
+    // The font is fixed pitch so the width of the longest line can be computed from its length.
+    // The length is in bytes which is an upper bound of the number of characters.
+    // Truncated lines are shown with an additional marker.
+    std::size_t max_line_length = _lines.max_line_length();
+    if (_max_line_size != 0)
+    {
+        std::size_t max_displayed_size = _max_line_size;
+        for (const auto& [key, size]: _expanded_line_sizes)
+            max_displayed_size = std::max(max_displayed_size, size);
+        max_line_length = std::min(max_line_length, max_displayed_size + 1);
+    }
+
+    const qint64 text_width = static_cast<qint64>(max_line_length)
+            * fontMetrics().horizontalAdvance(QLatin1Char('9'))
+        + 2 * _text_margin;
+    const int max_width = std::numeric_limits<int>::max() / 2;
+    horizontalScrollBar()->setPageStep(viewport()->width());
+    horizontalScrollBar()->setSingleStep(fontMetrics().horizontalAdvance(QLatin1Char('9')));
+    horizontalScrollBar()->setRange(
+        0, static_cast<int>(std::clamp<qint64>(text_width - viewport()->width(), 0, max_width)));
+}
+
+void log_widget_t::update_viewport()
+{
+    viewport()->update();
+    emit viewport_updated();
+}
+
+log_widget_t::line_highlight_t& log_widget_t::highlight_for(std::size_t line)
+{
+    const std::size_t key = removed_line_count() + line;
+    auto it = _highlights.find(key);
+    if (it == _highlights.end())
+    {
+        // The line is matched once against the rules, both for its formats and its tooltips.
+        const QString text = displayed_text(line);
+        line_highlight_t highlight;
+        highlight.length = static_cast<int>(text.size());
+        highlight.spans = _highlighter->spans_for(text);
+        highlight.formats = _highlighter->formats_for(highlight.spans, highlight.length);
+        it = _highlights.emplace(key, std::move(highlight)).first;
+    }
+
+    return it->second;
+}
+
+log_widget_t::line_highlight_t* log_widget_t::find_highlight(std::size_t line)
+{
+    auto it = _highlights.find(removed_line_count() + line);
+    return (it != _highlights.end()) ? &it->second : nullptr;
+}
+
+void log_widget_t::request_highlights(const std::vector<std::size_t>& lines)
+{
+    std::vector<highlighted_line_t> task_lines;
+    for (auto line: lines)
+    {
+        const std::size_t key = removed_line_count() + line;
+        if ((_highlights.count(key) != 0) || !_pending_highlights.insert(key).second)
+            continue;
+
+        task_lines.push_back({key, displayed_text(line), {}});
+        if (task_lines.size() == _lines_per_highlighting_task)
+            start_highlighting(std::exchange(task_lines, {}));
+    }
+
+    if (!task_lines.empty())
+        start_highlighting(std::move(task_lines));
+}
+
+void log_widget_t::start_highlighting(std::vector<highlighted_line_t> lines)
+{
+    _highlighting_thread_pool.start(
+        [this,
+         lines = std::move(lines),
+         matcher = _highlighter->span_matcher(),
+         is_cancelled = _is_highlighting_cancelled,
+         generation = _highlighting_generation]() mutable {
+            for (auto& line: lines)
+            {
+                if (*is_cancelled)
+                    return;
+
+                line.spans = matcher->spans_for(line.text);
+            }
+
+            QMetaObject::invokeMethod(
+                this,
+                [this, lines = std::move(lines), generation]() mutable {
+                    if (generation == _highlighting_generation)
+                        finish_highlighting(std::move(lines));
+                },
+                Qt::QueuedConnection);
+        });
+}
+
+void log_widget_t::finish_highlighting(std::vector<highlighted_line_t> lines)
+{
+    // Only the formats are computed here, from the spans found by the workers.
+    for (auto& line: lines)
+    {
+        _pending_highlights.erase(line.key);
+
+        line_highlight_t highlight;
+        highlight.length = static_cast<int>(line.text.size());
+        highlight.formats = _highlighter->formats_for(line.spans, highlight.length);
+        highlight.spans = std::move(line.spans);
+        _highlights.emplace(line.key, std::move(highlight));
+    }
+
+    viewport()->update();
+}
+
+void log_widget_t::cancel_highlighting()
+{
+    *_is_highlighting_cancelled = true;
+    _is_highlighting_cancelled = std::make_shared<std::atomic_bool>(false);
+    _pending_highlights.clear();
+    ++_highlighting_generation;
+}
+
+void log_widget_t::prefetch_highlights()
+{
+    if (row_count() == 0)
+        return;
+
+    const int margin = static_cast<int>(std::ceil(rows_per_page() * _prefetched_page_count));
+    const int first_row = std::max(0, first_visible_row() - margin);
+    const int last_row = std::min(row_count(), first_visible_row() + rows_per_page() + margin);
+
+    std::vector<std::size_t> lines;
+    for (int row = first_row; row < last_row; ++row)
+        lines.push_back(line_at_row(row));
+    request_highlights(lines);
+
+    // Only keep the highlighting of the lines around the viewport, to bound the memory used.
+    const std::size_t first_key = removed_line_count() + line_at_row(first_row);
+    const std::size_t last_key = removed_line_count() + line_at_row(last_row - 1);
+    if (_highlights.size() > 2 * static_cast<std::size_t>(last_row - first_row))
+    {
+        for (auto it = _highlights.begin(); it != _highlights.end();)
+        {
+            if ((it->first < first_key) || (it->first > last_key))
+                it = _highlights.erase(it);
+            else
+                ++it;
+        }
+    }
+}
+
+void log_widget_t::forget_highlights_from(std::size_t first_line)
+{
+    const std::size_t first_key = removed_line_count() + first_line;
+
+    // The lines being highlighted might have changed as well.
+    if (std::any_of(_pending_highlights.begin(), _pending_highlights.end(), [&](std::size_t key) {
+            return key >= first_key;
+        }))
+        cancel_highlighting();
+
+    for (auto it = _highlights.begin(); it != _highlights.end();)
+    {
+        if (it->first >= first_key)
+            it = _highlights.erase(it);
+        else
+            ++it;
+    }
+
+    for (auto it = _text_line_counts.begin(); it != _text_line_counts.end();)
+    {
+        if (it->first >= first_key)
+            it = _text_line_counts.erase(it);
+        else
+            ++it;
+    }
+}
+} // namespace flan
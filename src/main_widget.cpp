@@ -8,7 +8,10 @@
 #include <flan/rule_model.hpp>
 #include <flan/rule_set.hpp>
 #include <flan/rule_tree_widget.hpp>
+#include <flan/text_batcher.hpp>
 #include <QAction>
+#include <QLocale>
+#include <QMenu>
 #include <QPushButton>
 #include <QSplitter>
 #include <QVBoxLayout>
@@ -48,12 +51,15 @@ styled_matching_rule_list_t get_styled_rules_from_node(const base_node_t* node)
 
 main_widget_t::main_widget_t(QWidget* parent)
     : QWidget{parent}
+    , _text_batcher{new text_batcher_t{this}}
     , _data_source{new data_source_selection_widget_t}
     , _rules{new rule_tree_widget_t}
     , _log{new log_widget_t}
     , _log_margin{new log_margin_area_widget_t{_log}}
     , _find_controller{new find_controller_t{_log, this}}
     , _find{new find_widget_t{_find_controller}}
+    , _max_line_size_button{new QToolButton}
+    , _max_line_size_actions{new QActionGroup{this}}
 {
     connect(
         _data_source,
@@ -61,6 +67,10 @@ main_widget_t::main_widget_t(QWidget* parent)
         this,
         &main_widget_t::on_current_data_source_changed);
 
+    // New text is gathered in batches so that the log is updated at most once per frame no matter
+    // how fast the data source emits text.
+    connect(_text_batcher, &text_batcher_t::text_ready, _log, &log_widget_t::append_text);
+
     auto data_source_and_rules_separator = new QFrame;
     data_source_and_rules_separator->setFrameShape(QFrame::HLine);
     data_source_and_rules_separator->setFrameShadow(QFrame::Sunken);
@@ -90,10 +100,30 @@ main_widget_t::main_widget_t(QWidget* parent)
     auto clear_button = new QPushButton{tr("Clear")};
     connect(clear_button, &QPushButton::clicked, _log, &log_widget_t::clear);
 
+    // Only the beginning of very long lines is shown, highlighted and filtered.
+    _max_line_size_button->setText(tr("Line size"));
+    _max_line_size_button->setToolTip(tr("Amount of bytes shown from each line"));
+    _max_line_size_button->setPopupMode(QToolButton::InstantPopup);
+    _max_line_size_button->setMenu(new QMenu{_max_line_size_button});
+    _max_line_size_actions->setExclusionPolicy(QActionGroup::ExclusionPolicy::ExclusiveOptional);
+
+    const QLocale locale;
+    for (std::size_t byte_count: {1, 4, 16, 64, 256, 1024})
+    {
+        byte_count *= 1024;
+        add_max_line_size(
+            tr("Show the first %1").arg(locale.formattedDataSize(
+                static_cast<qint64>(byte_count), 0, QLocale::DataSizeTraditionalFormat)),
+            byte_count);
+    }
+    add_max_line_size(tr("Show whole lines"), 0);
+    update_max_line_size();
+
     auto bottom_layout = new QHBoxLayout;
     bottom_layout->setContentsMargins(0, 0, 0, 0);
     bottom_layout->addWidget(_data_source, 1);
     bottom_layout->addWidget(default_visibility_checkbox);
+    bottom_layout->addWidget(_max_line_size_button);
     bottom_layout->addWidget(pause_button);
     bottom_layout->addWidget(clear_button);
 
@@ -149,9 +179,20 @@ void main_widget_t::set_timestamp_formats(timestamp_format_list_t formats)
     _log_margin->set_timestamp_formats(std::move(formats));
 }
 
+std::size_t main_widget_t::max_line_size() const
+{
+    return _log->max_line_size();
+}
+
+void main_widget_t::set_max_line_size(std::size_t max_line_size)
+{
+    _log->set_max_line_size(max_line_size);
+    update_max_line_size();
+}
+
 void main_widget_t::set_content(const QString& text)
 {
-    _log->setPlainText(text);
+    _log->set_text(text);
 }
 
 void main_widget_t::set_model(rule_model_t* model)
@@ -183,16 +224,67 @@ void main_widget_t::set_model(rule_model_t* model)
 void main_widget_t::on_current_data_source_changed(data_source_t* data_source)
 {
     if (_current_data_source)
+    {
+        disconnect(_current_data_source, nullptr, _text_batcher, nullptr);
         disconnect(_current_data_source, nullptr, _log, nullptr);
+    }
+
+    // Drop any text from the previous data source not yet appended to the log.
+    _text_batcher->discard();
 
     _current_data_source = data_source;
+    _log->set_editable(_current_data_source && _current_data_source->is_editable());
     if (_current_data_source)
     {
-        connect(_current_data_source, &data_source_t::new_text, _log, [this](auto text) {
-            _log->append_text(text);
+        connect(
+            _current_data_source,
+            &data_source_t::new_text,
+            _text_batcher,
+            &text_batcher_t::add_text);
+        connect(
+            _current_data_source,
+            &data_source_t::new_line_block,
+            _log,
+            [this](line_block_ptr_t block) {
+                // Keep the content in order by appending the pending text first.
+                _text_batcher->flush();
+                _log->append_line_block(std::move(block));
+            });
+        connect(_current_data_source, &data_source_t::content_reset, _log, [this]() {
+            _text_batcher->discard();
+            _log->clear();
         });
+        connect(
+            _current_data_source,
+            &data_source_t::retention_policy_changed,
+            _log,
+            &log_widget_t::set_retention_policy);
+
         _log->clear();
+        _log->set_retention_policy(_current_data_source->retention_policy());
         _log->append_text(_current_data_source->text());
+        for (auto& block: _current_data_source->line_blocks())
+            _log->append_line_block(block);
     }
 }
+
+void main_widget_t::add_max_line_size(const QString& text, std::size_t max_line_size)
+{
+    auto action = _max_line_size_button->menu()->addAction(text);
+    action->setCheckable(true);
+    action->setData(static_cast<qulonglong>(max_line_size));
+    _max_line_size_actions->addAction(action);
+
+    connect(action, &QAction::triggered, this, [this, max_line_size]() {
+        set_max_line_size(max_line_size);
+    });
+}
+
+void main_widget_t::update_max_line_size()
+{
+    // A size set from the settings might not be one of the choices.
+    const auto max_line_size = _log->max_line_size();
+    for (auto action: _max_line_size_actions->actions())
+        action->setChecked(action->data().toULongLong() == max_line_size);
+}
 } // namespace flan
@@ -0,0 +1,108 @@
+#include <flan/multi_pattern_matcher.hpp>
+#include <flan/required_literals.hpp>
+#include <algorithm>
+#include <limits>
+#include <queue>
+
+namespace flan
+{
+namespace
+{
+constexpr std::uint32_t no_state = std::numeric_limits<std::uint32_t>::max();
+} // namespace
+
+multi_pattern_matcher_t::multi_pattern_matcher_t(const std::vector<QRegularExpression>& patterns)
+    : _pattern_count{patterns.size()}
+    , _always_candidates((patterns.size() + 63) / 64, 0)
+{
+    // Start by building the trie of the literals, missing transitions being marked as such.
+    auto add_state = [this]() {
+        _transitions.resize(_transitions.size() + alphabet_size, no_state);
+        _outputs.emplace_back();
+        return static_cast<std::uint32_t>(_outputs.size() - 1);
+    };
+
+    add_state();
+    for (std::size_t pattern = 0; pattern < patterns.size(); ++pattern)
+    {
+        const auto literals = required_literals(patterns[pattern]);
+        if (literals.isEmpty())
+            _always_candidates[pattern / 64] |= std::uint64_t{1} << (pattern % 64);
+
+        for (const auto& literal: literals)
+        {
+            const auto bytes = literal.toUtf8().left(max_literal_size);
+
+            std::uint32_t state = 0;
+            for (const char c: bytes)
+            {
+                // Adding a state invalidates references to the transitions, so use an index.
+                const auto index = state * alphabet_size + static_cast<std::uint8_t>(c);
+                if (_transitions[index] == no_state)
+                {
+                    const auto next_state = add_state();
+                    _transitions[index] = next_state;
+                }
+                state = _transitions[index];
+            }
+            _outputs[state].push_back(static_cast<std::uint32_t>(pattern));
+        }
+    }
+
+    // Then turn the trie into an automaton by following the failure links, in breadth first
+    // order so that the failure state of a state is always complete when reached.
+    std::vector<std::uint32_t> failures(_outputs.size(), 0);
+    std::queue<std::uint32_t> states;
+    for (std::size_t c = 0; c < alphabet_size; ++c)
+    {
+        auto& next_state = _transitions[c];
+        if (next_state == no_state)
+            next_state = 0;
+        else
+            states.push(next_state);
+    }
+
+    while (!states.empty())
+    {
+        const auto state = states.front();
+        states.pop();
+
+        // A literal ending in the failure state also ends in this state.
+        const auto& failure_outputs = _outputs[failures[state]];
+        auto& outputs = _outputs[state];
+        outputs.insert(outputs.end(), failure_outputs.begin(), failure_outputs.end());
+        std::sort(outputs.begin(), outputs.end());
+        outputs.erase(std::unique(outputs.begin(), outputs.end()), outputs.end());
+
+        for (std::size_t c = 0; c < alphabet_size; ++c)
+        {
+            auto& next_state = _transitions[state * alphabet_size + c];
+            const auto failure_next_state = _transitions[failures[state] * alphabet_size + c];
+            if (next_state == no_state)
+            {
+                next_state = failure_next_state;
+            }
+            else
+            {
+                failures[next_state] = failure_next_state;
+                states.push(next_state);
+            }
+        }
+    }
+}
+
+void multi_pattern_matcher_t::find_candidates(QByteArrayView text, candidates_t& candidates) const
+{
+    candidates = _always_candidates;
+    if (_outputs.size() <= 1)
+        return;
+
+    std::uint32_t state = 0;
+    for (const char c: text)
+    {
+        state = _transitions[state * alphabet_size + static_cast<std::uint8_t>(c)];
+        for (const auto pattern: _outputs[state])
+            candidates[pattern / 64] |= std::uint64_t{1} << (pattern % 64);
+    }
+}
+} // namespace flan
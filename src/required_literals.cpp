@@ -0,0 +1,415 @@
+#include <flan/required_literals.hpp>
+#include <algorithm>
+#include <cctype>
+
+namespace flan
+{
+namespace
+{
+//! Parse a regular expression pattern to find the literals required by each top level alternative.
+//!
+//! Only the longest sequence of mandatory literal characters of each alternative is kept. Groups,
+//! character classes and escape sequences other than escaped punctuation end a sequence.
+class literal_extractor_t
+{
+public:
+    explicit literal_extractor_t(const QString& pattern)
+        : _pattern{pattern}
+    {
+    }
+
+    //! Return the required literal of each top level alternative, or an empty list if at least
+    //! one alternative has none or if the pattern is not understood.
+    QStringList extract()
+    {
+        QStringList literals;
+
+        while (!at_end())
+        {
+            const QChar c = _pattern[_pos];
+            if (c == QLatin1Char('|'))
+            {
+                if (!end_alternative(literals))
+                    return {};
+                ++_pos;
+            }
+            else if (c == QLatin1Char('('))
+            {
+                end_run();
+                if (!skip_group())
+                    return {};
+            }
+            else if (c == QLatin1Char('['))
+            {
+                end_run();
+                if (!skip_class())
+                    return {};
+            }
+            else if (c == QLatin1Char('\\'))
+            {
+                if (!parse_escape())
+                    return {};
+            }
+            else if (
+                (c == QLatin1Char('.')) || (c == QLatin1Char('^')) || (c == QLatin1Char('$')))
+            {
+                end_run();
+                ++_pos;
+            }
+            else if (!parse_quantifier())
+            {
+                add_literal(c);
+                ++_pos;
+            }
+        }
+
+        if (!end_alternative(literals))
+            return {};
+
+        return literals;
+    }
+
+private:
+    bool at_end() const { return _pos >= _pattern.size(); }
+
+    QChar peek(qsizetype offset = 0) const
+    {
+        return (_pos + offset < _pattern.size()) ? _pattern[_pos + offset] : QChar{};
+    }
+
+    void add_literal(QChar c)
+    {
+        // Keep surrogate pairs together so that a quantifier removes the whole code point.
+        if (!c.isLowSurrogate() || _run.isEmpty() || !_run.back().isHighSurrogate())
+            _last_atom_start = _run.size();
+        _run.append(c);
+    }
+
+    void end_run()
+    {
+        if (_run.size() > _best_run.size())
+            _best_run = _run;
+        _run.clear();
+        _last_atom_start = -1;
+    }
+
+    bool end_alternative(QStringList& literals)
+    {
+        end_run();
+
+        // Invalid UTF-8 is replaced when decoding lines, so this character can't be searched in
+        // UTF-8 encoded lines.
+        if (_best_run.isEmpty() || _best_run.contains(QChar::ReplacementCharacter))
+            return false;
+
+        literals.append(_best_run);
+        _best_run.clear();
+        return true;
+    }
+
+    //! Return \c true if the group starting at the current position changes the pattern options.
+    bool is_option_setting_group() const
+    {
+        if ((peek() != QLatin1Char('(')) || (peek(1) != QLatin1Char('?')))
+            return false;
+
+        static const QString option_characters = QStringLiteral("imnsxJU-^)");
+        return option_characters.contains(peek(2));
+    }
+
+    bool skip_group()
+    {
+        int depth = 0;
+        while (!at_end())
+        {
+            const QChar c = _pattern[_pos];
+            if (c == QLatin1Char('\\'))
+            {
+                if (!skip_escape_in_group())
+                    return false;
+                continue;
+            }
+
+            if (c == QLatin1Char('['))
+            {
+                if (!skip_class())
+                    return false;
+                continue;
+            }
+
+            if (c == QLatin1Char('('))
+            {
+                // Options might make the following literals case insensitive.
+                if (is_option_setting_group())
+                    return false;
+
+                // Comments end at the first closing parenthesis.
+                if ((peek(1) == QLatin1Char('?')) && (peek(2) == QLatin1Char('#')))
+                {
+                    const auto end = _pattern.indexOf(QLatin1Char(')'), _pos);
+                    if (end < 0)
+                        return false;
+                    _pos = end + 1;
+                    if (depth == 0)
+                        return true;
+                    continue;
+                }
+
+                ++depth;
+            }
+            else if (c == QLatin1Char(')'))
+            {
+                --depth;
+                if (depth == 0)
+                {
+                    ++_pos;
+                    return true;
+                }
+            }
+
+            ++_pos;
+        }
+
+        return false;
+    }
+
+    bool skip_escape_in_group()
+    {
+        if (peek(1) == QLatin1Char('Q'))
+        {
+            const auto end = _pattern.indexOf(QLatin1String("\\E"), _pos + 2);
+            _pos = (end < 0) ? _pattern.size() : end + 2;
+            return true;
+        }
+
+        _pos += 2;
+        return _pos <= _pattern.size();
+    }
+
+    bool skip_class()
+    {
+        ++_pos;
+        if (peek() == QLatin1Char('^'))
+            ++_pos;
+        if (peek() == QLatin1Char(']'))
+            ++_pos;
+
+        while (!at_end())
+        {
+            const QChar c = _pattern[_pos];
+            if (c == QLatin1Char('\\'))
+            {
+                if (peek(1) == QLatin1Char('Q'))
+                    return false;
+                _pos += 2;
+            }
+            else if ((c == QLatin1Char('[')) && (peek(1) == QLatin1Char(':')))
+            {
+                const auto end = _pattern.indexOf(QLatin1String(":]"), _pos + 2);
+                if (end < 0)
+                    return false;
+                _pos = end + 2;
+            }
+            else if (c == QLatin1Char(']'))
+            {
+                ++_pos;
+                return true;
+            }
+            else
+            {
+                ++_pos;
+            }
+        }
+
+        return false;
+    }
+
+    //! Skip the characters between \a open and \a close starting at the current position, if any.
+    bool skip_delimited(QChar open, QChar close)
+    {
+        if (peek() != open)
+            return true;
+
+        const auto end = _pattern.indexOf(close, _pos + 1);
+        if (end < 0)
+            return false;
+
+        _pos = end + 1;
+        return true;
+    }
+
+    void skip_while(bool (*predicate)(QChar), qsizetype max_count)
+    {
+        for (qsizetype i = 0; (i < max_count) && !at_end() && predicate(peek()); ++i)
+            ++_pos;
+    }
+
+    bool parse_escape()
+    {
+        const QChar c = peek(1);
+        if (c.isNull())
+            return false;
+
+        // Escaped punctuation is the punctuation character itself.
+        if (!c.isLetterOrNumber() && (c.unicode() < 128))
+        {
+            add_literal(c);
+            _pos += 2;
+            return true;
+        }
+
+        if (c == QLatin1Char('Q'))
+        {
+            _pos += 2;
+            while (!at_end()
+                   && !((peek() == QLatin1Char('\\')) && (peek(1) == QLatin1Char('E'))))
+            {
+                add_literal(peek());
+                ++_pos;
+            }
+            if (!at_end())
+                _pos += 2;
+            return true;
+        }
+
+        // Any other escape sequence is handled as a non literal atom. Only its length matters.
+        end_run();
+        _pos += 2;
+
+        auto is_hex_digit = [](QChar c) -> bool {
+            return (c.unicode() < 128) && std::isxdigit(c.unicode());
+        };
+        auto is_digit = [](QChar c) { return c.isDigit(); };
+        auto is_octal_digit = [](QChar c) {
+            return (c >= QLatin1Char('0')) && (c <= QLatin1Char('7'));
+        };
+        auto is_letter = [](QChar c) { return c.isLetter(); };
+
+        switch (c.unicode())
+        {
+        case 'x':
+            if (peek() == QLatin1Char('{'))
+                return skip_delimited(QLatin1Char('{'), QLatin1Char('}'));
+            skip_while(is_hex_digit, 2);
+            return true;
+        case 'o':
+        case 'N':
+            return skip_delimited(QLatin1Char('{'), QLatin1Char('}'));
+        case 'p':
+        case 'P':
+            if (peek() == QLatin1Char('{'))
+                return skip_delimited(QLatin1Char('{'), QLatin1Char('}'));
+            skip_while(is_letter, 1);
+            return true;
+        case 'c':
+            ++_pos;
+            return _pos <= _pattern.size();
+        case 'g':
+        case 'k':
+            if (peek() == QLatin1Char('-'))
+                ++_pos;
+            skip_while(is_digit, _pattern.size());
+            return skip_delimited(QLatin1Char('{'), QLatin1Char('}'))
+                && skip_delimited(QLatin1Char('<'), QLatin1Char('>'))
+                && skip_delimited(QLatin1Char('\''), QLatin1Char('\''));
+        case '0':
+            skip_while(is_octal_digit, 2);
+            return true;
+        default:
+            if (c.isDigit())
+                skip_while(is_digit, _pattern.size());
+            return true;
+        }
+    }
+
+    //! Parse the quantifier at the current position, if any, and apply it to the last atom.
+    bool parse_quantifier()
+    {
+        const QChar c = peek();
+        int min_count = 0;
+
+        if ((c == QLatin1Char('*')) || (c == QLatin1Char('?')))
+        {
+            ++_pos;
+        }
+        else if (c == QLatin1Char('+'))
+        {
+            min_count = 1;
+            ++_pos;
+        }
+        else if (c == QLatin1Char('{'))
+        {
+            // "{n}", "{n,}", "{n,m}" and "{,m}" are quantifiers, spaces being allowed by recent
+            // PCRE versions. Anything else is a literal. Mistaking a literal for a quantifier
+            // only drops literals, so be lenient here.
+            qsizetype end = _pos + 1;
+            bool has_digit = false;
+            bool has_comma = false;
+            while ((end < _pattern.size()) && (_pattern[end] != QLatin1Char('}')))
+            {
+                const QChar q = _pattern[end];
+                if (q.isDigit() && (q.unicode() < 128))
+                {
+                    if (!has_comma)
+                        min_count = std::min(min_count * 10 + q.digitValue(), 1000000);
+                    has_digit = true;
+                }
+                else if (q == QLatin1Char(','))
+                {
+                    has_comma = true;
+                }
+                else if (q != QLatin1Char(' '))
+                {
+                    return false;
+                }
+                ++end;
+            }
+
+            if (!has_digit || (end >= _pattern.size()))
+                return false;
+
+            _pos = end + 1;
+        }
+        else
+        {
+            return false;
+        }
+
+        // Lazy and possessive quantifiers match the same literals.
+        if ((peek() == QLatin1Char('?')) || (peek() == QLatin1Char('+')))
+            ++_pos;
+
+        // An optional atom is not required, and a repeated one can't be followed by the next
+        // literals, so the current sequence ends here either way.
+        if ((_last_atom_start >= 0) && (min_count == 0))
+            _run.truncate(_last_atom_start);
+        end_run();
+
+        return true;
+    }
+
+private:
+    const QString& _pattern;
+    qsizetype _pos = 0;
+    QString _run;
+    QString _best_run;
+    qsizetype _last_atom_start = -1;
+};
+} // namespace
+
+QStringList required_literals(const QRegularExpression& pattern)
+{
+    if (!pattern.isValid())
+        return {};
+
+    // Case insensitive patterns match other literals, and the extended syntax gives a different
+    // meaning to spaces and '#'.
+    const auto options = pattern.patternOptions();
+    if (options.testFlag(QRegularExpression::CaseInsensitiveOption)
+        || options.testFlag(QRegularExpression::ExtendedPatternSyntaxOption))
+        return {};
+
+    const QString pattern_text = pattern.pattern();
+    return literal_extractor_t{pattern_text}.extract();
+}
+} // namespace flan
@@ -1,10 +1,15 @@
 
 #include <flan/rule_highlighter.hpp>
+#include <algorithm>
+#include <queue>
 
 namespace flan
 {
 namespace
 {
+//! Format index of the characters not highlighted.
+constexpr int no_format = -1;
+
 constexpr QFont::Weight to_qt(font_weight_t font_weight)
 {
     switch (font_weight)
@@ -42,12 +47,55 @@ QTextCharFormat to_qt(const matching_style_t& style)
 }
 } // namespace
 
-rule_highlighter_t::rule_highlighter_t(QTextDocument* parent)
-    : QSyntaxHighlighter{parent}
+span_matcher_t::span_matcher_t(std::vector<QRegularExpression> patterns)
+    : _patterns{std::move(patterns)}
+    , _matcher{_patterns}
 {
 }
 
-void rule_highlighter_t::set_rules(styled_matching_rule_list_t rules)
+match_span_list_t span_matcher_t::spans_for(const QString& text) const
+{
+    match_span_list_t spans;
+
+    const auto candidates = _matcher.find_candidates(text.toUtf8());
+    for (std::size_t rule_index = 0; rule_index < _patterns.size(); ++rule_index)
+    {
+        if (!multi_pattern_matcher_t::is_candidate(candidates, rule_index))
+            continue;
+
+        QRegularExpressionMatchIterator match_it = _patterns[rule_index].globalMatch(text);
+        while (match_it.hasNext())
+        {
+            QRegularExpressionMatch match = match_it.next();
+
+            // Highlight each capture individually, or if no specific capture group was specified
+            // highlight the whole match.
+            int start_index = (match.lastCapturedIndex() == 0) ? 0 : 1;
+            for (int i = start_index; i <= match.lastCapturedIndex(); ++i)
+            {
+                // Captures not participating in the match have no span.
+                if (match.capturedStart(i) < 0)
+                    continue;
+
+                spans.push_back(
+                    {static_cast<std::uint32_t>(rule_index),
+                     static_cast<std::uint32_t>(i - start_index),
+                     static_cast<int>(match.capturedStart(i)),
+                     static_cast<int>(match.capturedLength(i))});
+            }
+        }
+    }
+
+    return spans;
+}
+
+rule_highlighter_t::rule_highlighter_t(QObject* parent)
+    : QObject{parent}
+    , _span_matcher{std::make_shared<span_matcher_t>()}
+{
+}
+
+bool rule_highlighter_t::set_rules(styled_matching_rule_list_t rules)
 {
     // Only copy the rules with highlighting turns on has the other ones have no impact for the
     // highlighter.
@@ -56,38 +104,168 @@ void rule_highlighter_t::set_rules(styled_matching_rule_list_t rules)
         rules.begin(),
         rules.end(),
         std::back_inserter(_rules),
-        [](const styled_matching_rule_t& rule) { return rule.rule.highlight_match; });
+        [](const styled_matching_rule_t& rule) {
+            return rule.rule.highlight_match && rule.rule.rule.isValid();
+        });
+
+    // Styles are resolved into formats once here rather than for every match. Rules with the
+    // same style share the same format.
+    _styles.clear();
+    _formats.clear();
+    _rule_formats.clear();
+    for (const auto& styled_rule: _rules)
+    {
+        auto& rule_formats = _rule_formats.emplace_back();
+        for (const auto& style: styled_rule.styles)
+            rule_formats.push_back(format_index_for(style));
+    }
 
-    rehighlight();
+    // The spans only depend on the patterns of the rules, so the matcher is kept if they didn't
+    // change (e.g. only a color was edited).
+    std::vector<QRegularExpression> patterns;
+    for (const auto& styled_rule: _rules)
+        patterns.push_back(styled_rule.rule.rule);
+    if (patterns == _span_matcher->patterns())
+        return false;
+
+    _span_matcher = std::make_shared<span_matcher_t>(std::move(patterns));
+    return true;
 }
 
-void rule_highlighter_t::highlightBlock(const QString& text)
+int rule_highlighter_t::format_index_for(const matching_style_t& style)
 {
-    // Iterator over the rules in reverse order to keep the first rule as highest priority.
-    for (auto rule_it = std::rbegin(_rules); rule_it != std::rend(_rules); ++rule_it)
-    {
-        const auto& styled_rule = *rule_it;
+    auto it = std::find(_styles.begin(), _styles.end(), style);
+    if (it != _styles.end())
+        return static_cast<int>(std::distance(_styles.begin(), it));
 
-        if (!styled_rule.rule.rule.isValid())
-            continue;
+    _styles.push_back(style);
+    _formats.push_back(to_qt(style));
+    return static_cast<int>(_formats.size() - 1);
+}
 
-        QRegularExpressionMatchIterator match_it = styled_rule.rule.rule.globalMatch(text);
-        while (match_it.hasNext())
+QVector<QTextLayout::FormatRange>
+rule_highlighter_t::formats_for(const match_span_list_t& spans, int length) const
+{
+    // Start by computing the format of each character individually. Overlapping matches simply
+    // overwrite the format of the previous ones.
+    std::vector<int> char_formats(length, no_format);
+    auto set_format = [&char_formats](int start, int length, int format_index) {
+        const int end = std::min(start + length, static_cast<int>(char_formats.size()));
+        for (int i = std::max(0, start); i < end; ++i)
+            char_formats[i] = format_index;
+    };
+
+    // Iterate over the spans of the rules in reverse order to keep the first rule as highest
+    // priority, but over the spans of a rule in order.
+    for (auto rule_end = spans.end(); rule_end != spans.begin();)
+    {
+        const auto rule = std::prev(rule_end)->rule;
+        auto rule_begin = rule_end;
+        while ((rule_begin != spans.begin()) && (std::prev(rule_begin)->rule == rule))
+            --rule_begin;
+
+        const auto& rule_formats = _rule_formats[rule];
+        if (!rule_formats.empty())
         {
-            QRegularExpressionMatch match = match_it.next();
+            for (auto it = rule_begin; it != rule_end; ++it)
+                set_format(
+                    it->start, it->length, rule_formats[it->capture % rule_formats.size()]);
+        }
 
-            // Highlight each capture individually, or if no specific capture group was specified
-            // highlight the whole match.
-            int start_index = (match.lastCapturedIndex() == 0) ? 0 : 1;
-            for (int i = start_index, style_index = 0; i <= match.lastCapturedIndex();
-                 ++i, ++style_index)
-            {
-                setFormat(
-                    match.capturedStart(i),
-                    match.capturedLength(i),
-                    to_qt(styled_rule.styles[style_index % styled_rule.styles.size()]));
-            }
+        rule_end = rule_begin;
+    }
+
+    // Then merge consecutive characters with the same format into a single range.
+    QVector<QTextLayout::FormatRange> ranges;
+    for (int start = 0; start < static_cast<int>(char_formats.size());)
+    {
+        int end = start + 1;
+        while ((end < static_cast<int>(char_formats.size()))
+               && (char_formats[end] == char_formats[start]))
+            ++end;
+
+        if (char_formats[start] != no_format)
+        {
+            QTextLayout::FormatRange range;
+            range.start = start;
+            range.length = end - start;
+            range.format = _formats[char_formats[start]];
+            ranges.append(range);
         }
+
+        start = end;
+    }
+
+    return ranges;
+}
+
+tooltip_index_t rule_highlighter_t::tooltip_index_for(const match_span_list_t& spans) const
+{
+    // The positions where the rule of the tooltip might change.
+    std::vector<int> bounds;
+    std::vector<const match_span_t*> sorted_spans;
+    for (const auto& span: spans)
+    {
+        if (span.length <= 0)
+            continue;
+
+        bounds.push_back(span.start);
+        bounds.push_back(span.start + span.length);
+        sorted_spans.push_back(&span);
     }
+    std::sort(bounds.begin(), bounds.end());
+    bounds.erase(std::unique(bounds.begin(), bounds.end()), bounds.end());
+    std::stable_sort(sorted_spans.begin(), sorted_spans.end(), [](auto lhs, auto rhs) {
+        return lhs->start < rhs->start;
+    });
+
+    // Sweep the bounds while keeping the spans started so far in a heap, with the first rule on
+    // top. Spans ended are only removed once on top, as they don't matter before.
+    auto has_lower_priority = [](const match_span_t* lhs, const match_span_t* rhs) {
+        return lhs->rule > rhs->rule;
+    };
+    std::priority_queue<
+        const match_span_t*,
+        std::vector<const match_span_t*>,
+        decltype(has_lower_priority)>
+        started_spans{has_lower_priority};
+
+    tooltip_index_t index;
+    auto next_span = sorted_spans.begin();
+    for (std::size_t i = 0; i + 1 < bounds.size(); ++i)
+    {
+        const int start = bounds[i];
+        for (; (next_span != sorted_spans.end()) && ((*next_span)->start <= start); ++next_span)
+            started_spans.push(*next_span);
+        while (!started_spans.empty()
+               && (started_spans.top()->start + started_spans.top()->length <= start))
+            started_spans.pop();
+
+        if (started_spans.empty())
+            continue;
+
+        const auto rule = started_spans.top()->rule;
+        if (!index.empty() && (index.back().end == start) && (index.back().rule == rule))
+            index.back().end = bounds[i + 1];
+        else
+            index.push_back({start, bounds[i + 1], rule});
+    }
+
+    return index;
+}
+
+QString rule_highlighter_t::tooltip_for(const tooltip_index_t& index, int column) const
+{
+    // Find the last range starting at or before column.
+    auto it = std::upper_bound(
+        index.begin(), index.end(), column, [](int column, const tooltip_range_t& range) {
+            return column < range.start;
+        });
+    if ((it == index.begin()) || (column >= std::prev(it)->end))
+        return {};
+
+    // Use the rule tooltip if non empty, otherwise default to the rule name.
+    const auto& rule = _rules[std::prev(it)->rule].rule;
+    return rule.tooltip.isEmpty() ? rule.name : rule.tooltip;
 }
 } // namespace flan
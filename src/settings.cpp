@@ -47,6 +47,14 @@ static const auto settings_key_timestamp_formats_hour_index{"hour_index"};
 static const auto settings_key_timestamp_formats_minute_index{"minute_index"};
 static const auto settings_key_timestamp_formats_second_index{"second_index"};
 static const auto settings_key_timestamp_formats_millisecond_index{"millisecond_index"};
+static const auto settings_key_timestamp_formats_spec{"spec"};
+static const auto settings_key_timestamp_formats_year_index{"year_index"};
+static const auto settings_key_timestamp_formats_month_index{"month_index"};
+static const auto settings_key_timestamp_formats_day_index{"day_index"};
+static const auto settings_key_timestamp_formats_fraction_index{"fraction_index"};
+static const auto settings_key_timestamp_formats_utc_offset_index{"utc_offset_index"};
+
+static const auto settings_key_options_max_line_size{"max_line_size"};
 
 //! Cast an enum class value \a to its underlying type
 template <typename Enum>
@@ -73,6 +81,11 @@ QString get_default_settings_file_for_timestamp_formats()
     return QFileInfo{QDir{get_default_settings_directory()}, "timestamp_formats.json"}.filePath();
 }
 
+QString get_default_settings_file_for_options()
+{
+    return QFileInfo{QDir{get_default_settings_directory()}, "options.json"}.filePath();
+}
+
 QVariant style_to_variant(const matching_style_t& style)
 {
     QVariantMap map;
@@ -372,6 +385,12 @@ QVariant timestmap_format_to_variant(const timestamp_format_t& format)
     map[settings_key_timestamp_formats_minute_index] = format.minute_index;
     map[settings_key_timestamp_formats_second_index] = format.second_index;
     map[settings_key_timestamp_formats_millisecond_index] = format.millisecond_index;
+    map[settings_key_timestamp_formats_spec] = format.spec.text();
+    map[settings_key_timestamp_formats_year_index] = format.year_index;
+    map[settings_key_timestamp_formats_month_index] = format.month_index;
+    map[settings_key_timestamp_formats_day_index] = format.day_index;
+    map[settings_key_timestamp_formats_fraction_index] = format.fraction_index;
+    map[settings_key_timestamp_formats_utc_offset_index] = format.utc_offset_index;
 
     return {map};
 }
@@ -413,6 +432,15 @@ std::optional<timestamp_format_t> timestamp_format_from_variant(const QVariant&
     format.minute_index = map.value(settings_key_timestamp_formats_minute_index).toInt();
     format.second_index = map.value(settings_key_timestamp_formats_second_index).toInt();
     format.millisecond_index = map.value(settings_key_timestamp_formats_millisecond_index).toInt();
+    format.spec = map.value(settings_key_timestamp_formats_spec).toString();
+
+    // These components were added later, so they are missing from older settings.
+    format.year_index = map.value(settings_key_timestamp_formats_year_index, -1).toInt();
+    format.month_index = map.value(settings_key_timestamp_formats_month_index, -1).toInt();
+    format.day_index = map.value(settings_key_timestamp_formats_day_index, -1).toInt();
+    format.fraction_index = map.value(settings_key_timestamp_formats_fraction_index, -1).toInt();
+    format.utc_offset_index =
+        map.value(settings_key_timestamp_formats_utc_offset_index, -1).toInt();
 
     return format;
 }
@@ -448,4 +476,51 @@ timestamp_format_list_t load_timestamp_formats_from_json(QString file_path)
     auto variant = QJsonDocument::fromJson(json).toVariant();
     return timestamp_formats_from_variant(variant);
 }
+
+QVariant options_to_variant(const options_t& options)
+{
+    QVariantMap map;
+    if (options.max_line_size)
+        map[settings_key_options_max_line_size] =
+            static_cast<qulonglong>(*options.max_line_size);
+
+    return {map};
+}
+
+void save_options_to_json(const options_t& options, QString file_path)
+{
+    auto variant = options_to_variant(options);
+    auto json = QJsonDocument::fromVariant(variant).toJson(QJsonDocument::JsonFormat::Indented);
+    QSaveFile file{file_path};
+    file.open(QIODevice::WriteOnly);
+    file.write(json);
+    file.commit();
+}
+
+options_t options_from_variant(const QVariant& variant)
+{
+    if (!variant.canConvert<QVariantMap>())
+        return {};
+    auto map = variant.value<QVariantMap>();
+
+    options_t options;
+    auto max_line_size_variant = map.value(settings_key_options_max_line_size);
+    bool is_valid = false;
+    auto max_line_size = max_line_size_variant.toULongLong(&is_valid);
+    if (is_valid)
+        options.max_line_size = static_cast<std::size_t>(max_line_size);
+
+    return options;
+}
+
+options_t load_options_from_json(QString file_path)
+{
+    QFile file{file_path};
+    if (!file.exists() || !file.open(QIODevice::ReadOnly))
+        return {};
+    auto json = file.readAll();
+    file.close();
+    auto variant = QJsonDocument::fromJson(json).toVariant();
+    return options_from_variant(variant);
+}
 } // namespace flan
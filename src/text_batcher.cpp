@@ -0,0 +1,42 @@
+#include <flan/text_batcher.hpp>
+
+namespace flan
+{
+text_batcher_t::text_batcher_t(QObject* parent)
+    : QObject{parent}
+{
+    _timer.setSingleShot(true);
+    _timer.setInterval(interval);
+    connect(&_timer, &QTimer::timeout, this, &text_batcher_t::flush);
+}
+
+void text_batcher_t::add_text(const QString& text)
+{
+    _text.append(text);
+
+    if (_text.size() >= max_size)
+        flush();
+    else if (!_timer.isActive())
+        _timer.start();
+}
+
+void text_batcher_t::flush()
+{
+    _timer.stop();
+
+    if (!_text.isEmpty())
+    {
+        // Move the text out first so that the batcher is ready for new text even if a slot
+        // connected to text_ready() adds more text.
+        QString text;
+        text.swap(_text);
+        emit text_ready(text);
+    }
+}
+
+void text_batcher_t::discard()
+{
+    _timer.stop();
+    _text.clear();
+}
+} // namespace flan
@@ -0,0 +1,226 @@
+#include <flan/timestamp_column.hpp>
+#include <QtConcurrent/QtConcurrentMap>
+#include <algorithm>
+#include <utility>
+
+namespace flan
+{
+void timestamp_column_t::set_formats(timestamp_format_list_t formats)
+{
+    _formats = std::move(formats);
+    forget_lines_from(0);
+}
+
+void timestamp_column_t::set_max_line_size(std::size_t max_line_size)
+{
+    if (_max_line_size == max_line_size)
+        return;
+
+    _max_line_size = max_line_size;
+    forget_lines_from(0);
+}
+
+timestamp_column_t::parse_job_t timestamp_column_t::parse_job(std::size_t last_line) const
+{
+    parse_job_t job;
+    if (_formats.empty())
+        return job;
+
+    job.formats = _formats;
+    job.max_line_size = _max_line_size;
+    job.first_line = _timestamps.size();
+    job.last_line = std::max(last_line, job.first_line);
+    return job;
+}
+
+bool timestamp_column_t::run(
+    parse_job_t& job,
+    const line_store_t& lines,
+    const std::atomic_bool& is_cancelled)
+{
+    if (job.is_empty())
+        return true;
+
+    job.timestamps.assign(job.last_line - job.first_line, no_timestamp);
+
+    struct task_t
+    {
+        std::size_t first_line;
+        std::size_t last_line;
+    };
+
+    std::vector<task_t> tasks;
+    for (auto line = job.first_line; line < job.last_line;)
+    {
+        const auto task_last_line = std::min(line + lines_per_task, job.last_line);
+        tasks.push_back({line, task_last_line});
+        line = task_last_line;
+    }
+
+    auto parse = [&](const task_t& task) {
+        for (auto line = task.first_line; (line < task.last_line) && !is_cancelled; ++line)
+            job.timestamps[line - job.first_line] =
+                parse_line(job.formats, job.max_line_size, lines, line);
+    };
+
+    // Dispatching a single task to the thread pool would only add latency.
+    if (tasks.size() == 1)
+        parse(tasks.front());
+    else if (tasks.size() > 1)
+        QtConcurrent::blockingMap(tasks, parse);
+
+    return !is_cancelled;
+}
+
+timestamp_t timestamp_column_t::parse_line(
+    const timestamp_format_list_t& formats,
+    std::size_t max_line_size,
+    const line_store_t& lines,
+    std::size_t line)
+{
+    // Formats with a spec work on the raw bytes, so the line is only decoded if a format with a
+    // regular expression is reached.
+    const auto bytes = truncated_line(lines.line_bytes(line), max_line_size);
+    std::optional<QString> text;
+    for (const auto& format: formats)
+    {
+        timestamp_t timestamp = no_timestamp;
+        if (auto parser = format.spec.parser())
+        {
+            timestamp = parser->timestamp_for(bytes);
+        }
+        else
+        {
+            if (!text)
+                text = QString::fromUtf8(bytes);
+            timestamp = format.timestamp_for(*text);
+        }
+
+        if (timestamp != no_timestamp)
+            return timestamp;
+    }
+
+    return no_timestamp;
+}
+
+void timestamp_column_t::merge(parse_job_t job, std::size_t valid_line_count)
+{
+    // The timestamps must continue exactly where the job started.
+    const std::size_t first_line = _timestamps.size();
+    const std::size_t last_line = std::min(job.last_line, valid_line_count);
+    if ((job.first_line != first_line) || (first_line >= last_line))
+        return;
+
+    _timestamps.insert(
+        _timestamps.end(),
+        job.timestamps.begin(),
+        job.timestamps.begin() + (last_line - first_line));
+
+    update_zones_from(first_line);
+
+    if (!_has_dates)
+        _has_dates = std::any_of(
+            _timestamps.begin() + first_line, _timestamps.end(), [](timestamp_t timestamp) {
+                return (timestamp != no_timestamp)
+                    && ((timestamp < 0) || (timestamp >= nanoseconds_per_day));
+            });
+}
+
+std::size_t timestamp_column_t::first_line_at_or_after(timestamp_t timestamp) const
+{
+    // The first zone reaching the timestamp is the first one whose latest timestamp so far does.
+    auto zone = std::lower_bound(
+        _zones.begin(), _zones.end(), timestamp, [](const zone_t& zone, timestamp_t timestamp) {
+            return zone.max_so_far < timestamp;
+        });
+
+    // The latest timestamp of the zone might come from a line removed since, in which case the
+    // next zones reaching the timestamp are scanned as well.
+    for (; zone != _zones.end(); ++zone)
+    {
+        if (zone->max < timestamp)
+            continue;
+
+        const std::size_t zone_first_line = std::distance(_zones.begin(), zone) * lines_per_zone;
+        const std::size_t first_line =
+            (zone_first_line > _zone_offset) ? zone_first_line - _zone_offset : 0;
+        const std::size_t last_line =
+            std::min(zone_first_line + lines_per_zone - _zone_offset, _timestamps.size());
+        for (std::size_t line = first_line; line < last_line; ++line)
+        {
+            if ((_timestamps[line] != no_timestamp) && (_timestamps[line] >= timestamp))
+                return line;
+        }
+    }
+
+    return _timestamps.size();
+}
+
+void timestamp_column_t::forget_lines_from(std::size_t first_line)
+{
+    if (first_line == 0)
+        _has_dates = false;
+
+    if (first_line >= _timestamps.size())
+        return;
+
+    _timestamps.resize(first_line);
+
+    // The zone of the first line forgotten is computed again from the lines left in it.
+    const std::size_t first_zone = zone_for(first_line);
+    _zones.resize(first_zone);
+    const std::size_t zone_first_line = first_zone * lines_per_zone;
+    update_zones_from((zone_first_line > _zone_offset) ? zone_first_line - _zone_offset : 0);
+}
+
+void timestamp_column_t::remove_first_lines(std::size_t line_count)
+{
+    _timestamps.erase(
+        _timestamps.begin(),
+        _timestamps.begin() + std::min(line_count, _timestamps.size()));
+
+    if (_timestamps.empty())
+    {
+        _zones.clear();
+        _zone_offset = 0;
+        return;
+    }
+
+    // The zones stay aligned on the same lines, so only the zones whose lines have all been
+    // removed are removed.
+    const std::size_t removed_zone_offset = _zone_offset + line_count;
+    _zones.erase(_zones.begin(), _zones.begin() + removed_zone_offset / lines_per_zone);
+    _zone_offset = removed_zone_offset % lines_per_zone;
+}
+
+void timestamp_column_t::remove_first_lines(parse_job_t& job, std::size_t line_count)
+{
+    // The timestamps of the lines removed are dropped, if the job had parsed any.
+    const std::size_t removed_job_line_count = std::min(
+        (line_count > job.first_line) ? line_count - job.first_line : 0, job.timestamps.size());
+    job.timestamps.erase(job.timestamps.begin(), job.timestamps.begin() + removed_job_line_count);
+
+    job.first_line -= std::min(line_count, job.first_line);
+    job.last_line -= std::min(line_count, job.last_line);
+}
+
+void timestamp_column_t::update_zones_from(std::size_t first_line)
+{
+    if (first_line >= _timestamps.size())
+        return;
+
+    const std::size_t first_zone = zone_for(first_line);
+    _zones.resize(zone_for(_timestamps.size() - 1) + 1);
+    for (std::size_t line = first_line; line < _timestamps.size(); ++line)
+    {
+        auto& zone = _zones[zone_for(line)];
+        zone.max = std::max(zone.max, _timestamps[line]);
+    }
+
+    for (std::size_t zone = first_zone; zone < _zones.size(); ++zone)
+    {
+        const timestamp_t previous_max = (zone > 0) ? _zones[zone - 1].max_so_far : no_timestamp;
+        _zones[zone].max_so_far = std::max(previous_max, _zones[zone].max);
+    }
+}
+} // namespace flan
@@ -1,100 +1,314 @@
-
 #include <flan/timestamp_format.hpp>
-#include <chrono>
+#include <flan/timestamp_parser.hpp>
+#include <QDataStream>
+#include <limits>
 
 namespace flan
 {
+namespace
+{
+//! Maximum number of digits of a captured component, so that computing the timestamp doesn't
+//! overflow.
+constexpr int max_captured_digit_count = 12;
+
+//! Maximum absolute value of a year, so that computing the timestamp doesn't overflow.
+constexpr qint64 max_year = 1000 * 1000;
+
+constexpr qint64 seconds_per_day = 24 * 60 * 60;
+
+//! Written first in a stream of a timestamp format, followed by the version of the stream. Streams
+//! without a version start with the is_enabled boolean instead, which is either 0 or 1.
+constexpr quint8 stream_version_marker = 0xFF;
+
+//! Version of the stream of a timestamp format, incremented whenever fields are added.
+//!
+//! - 1: spec, and the year, month, day, fraction and UTC offset indexes
+constexpr quint8 stream_version = 1;
+
+//! Return the value of the decimal number captured at \a index by \a match, or
+//! \a default_value if the capture index does not correspond to anything.
+//!
+//! If the capture is not a number, 0 is returned as for a missing component of a timestamp.
+qint64 captured_number(const QRegularExpressionMatch& match, int index, qint64 default_value = 0)
+{
+    if (index < 0)
+        return default_value;
+
+    const QStringView digits = match.capturedView(index);
+    if (digits.isEmpty())
+        return default_value;
+    if (digits.size() > max_captured_digit_count)
+        return 0;
+
+    qint64 value = 0;
+    for (const QChar c: digits)
+    {
+        if ((c < u'0') || (c > u'9'))
+            return 0;
+
+        value = value * 10 + (c.unicode() - u'0');
+    }
+
+    return value;
+}
+
+//! Return the number of nanoseconds of the decimal fraction of second captured at \a index by
+//! \a match. Digits after the nanoseconds are ignored.
+qint64 captured_fraction(const QRegularExpressionMatch& match, int index)
+{
+    if (index < 0)
+        return 0;
+
+    qint64 value = 0;
+    qint64 scale = nanoseconds_per_second;
+    for (const QChar c: match.capturedView(index))
+    {
+        if ((c < u'0') || (c > u'9'))
+            return 0;
+
+        scale /= 10;
+        value += (c.unicode() - u'0') * scale;
+    }
+
+    return value;
+}
+
+//! Return the number of days from 1970-01-01 to the date, in the proleptic Gregorian calendar.
+qint64 days_from_civil(qint64 year, qint64 month, qint64 day)
+{
+    // Years start in March so that the leap day is the last day of the year.
+    year -= (month <= 2) ? 1 : 0;
+    const qint64 era = ((year >= 0) ? year : year - 399) / 400;
+    const qint64 year_of_era = year - era * 400;
+    const qint64 day_of_year = (153 * ((month > 2) ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    const qint64 day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+    return era * 146097 + day_of_era - 719468;
+}
+
+//! Set \a year, \a month and \a day to the date \a days after 1970-01-01.
+void civil_from_days(qint64 days, qint64& year, qint64& month, qint64& day)
+{
+    days += 719468;
+    const qint64 era = ((days >= 0) ? days : days - 146096) / 146097;
+    const qint64 day_of_era = days - era * 146097;
+    const qint64 year_of_era =
+        (day_of_era - day_of_era / 1460 + day_of_era / 36524 - day_of_era / 146096) / 365;
+    const qint64 day_of_year =
+        day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+    const qint64 shifted_month = (5 * day_of_year + 2) / 153;
+
+    day = day_of_year - (153 * shifted_month + 2) / 5 + 1;
+    month = (shifted_month < 10) ? shifted_month + 3 : shifted_month - 9;
+    year = year_of_era + era * 400 + ((month <= 2) ? 1 : 0);
+}
+
+//! Return hh:mm:ss.ffffff for the \a nanoseconds since the start of a day.
+QString time_of_day_to_string(qint64 nanoseconds)
+{
+    const qint64 seconds = nanoseconds / nanoseconds_per_second;
+    return QStringLiteral("%1:%2:%3.%4")
+        .arg(seconds / 3600, 2, 10, QLatin1Char('0'))
+        .arg(seconds / 60 % 60, 2, 10, QLatin1Char('0'))
+        .arg(seconds % 60, 2, 10, QLatin1Char('0'))
+        .arg(nanoseconds % nanoseconds_per_second / 1000, 6, 10, QLatin1Char('0'));
+}
+} // namespace
+
+timestamp_t timestamp_from(const timestamp_fields_t& fields)
+{
+    if ((fields.month < 1) || (fields.month > 12) || (fields.day < 1) || (fields.day > 31)
+        || (fields.year < -max_year) || (fields.year > max_year))
+        return no_timestamp;
+
+    const qint64 seconds = days_from_civil(fields.year, fields.month, fields.day) * seconds_per_day
+        + fields.hour * 3600 + fields.minute * 60 + fields.second - fields.utc_offset
+        + fields.nanosecond / nanoseconds_per_second;
+
+    constexpr qint64 max_seconds =
+        std::numeric_limits<timestamp_t>::max() / nanoseconds_per_second - 1;
+    if ((seconds < -max_seconds) || (seconds > max_seconds))
+        return no_timestamp;
+
+    return seconds * nanoseconds_per_second + fields.nanosecond % nanoseconds_per_second;
+}
+
+QString timestamp_to_string(timestamp_t timestamp)
+{
+    if (timestamp == no_timestamp)
+        return {};
+
+    // Round the days down so that the time of day is never negative.
+    qint64 days = timestamp / nanoseconds_per_day;
+    if (timestamp % nanoseconds_per_day < 0)
+        --days;
+
+    const QString time = time_of_day_to_string(timestamp - days * nanoseconds_per_day);
+    if (days == 0)
+        return time;
+
+    qint64 year = 0;
+    qint64 month = 0;
+    qint64 day = 0;
+    civil_from_days(days, year, month, day);
+    return QStringLiteral("%1-%2-%3T%4")
+        .arg(year, 4, 10, QLatin1Char('0'))
+        .arg(month, 2, 10, QLatin1Char('0'))
+        .arg(day, 2, 10, QLatin1Char('0'))
+        .arg(time);
+}
+
+QString duration_to_string(qint64 duration)
+{
+    QString text;
+    if (duration < 0)
+    {
+        text.append(QLatin1Char('-'));
+        duration = -duration;
+    }
+
+    if (const qint64 days = duration / nanoseconds_per_day; days > 0)
+        text.append(QStringLiteral("%1d ").arg(days));
+
+    text.append(time_of_day_to_string(duration % nanoseconds_per_day));
+    return text;
+}
+
 QDataStream& operator<<(QDataStream& out, const timestamp_format_t& format)
 {
-    return out << format.is_enabled << format.name << format.regexp << format.hour_index
-               << format.minute_index << format.second_index << format.millisecond_index;
+    return out << stream_version_marker << stream_version << format.is_enabled << format.name
+               << format.regexp << format.hour_index << format.minute_index << format.second_index
+               << format.millisecond_index << format.spec.text() << format.year_index
+               << format.month_index << format.day_index << format.fraction_index
+               << format.utc_offset_index;
 }
 
 QDataStream& operator>>(QDataStream& in, timestamp_format_t& format)
 {
-    return in >> format.is_enabled >> format.name >> format.regexp >> format.hour_index
-        >> format.minute_index >> format.second_index >> format.millisecond_index;
+    format = timestamp_format_t{};
+
+    // Streams without a version only have the fields up to the index of the milliseconds.
+    quint8 version = 0;
+    quint8 first_byte = 0;
+    in >> first_byte;
+    if (first_byte == stream_version_marker)
+    {
+        in >> version;
+        if (version > stream_version)
+        {
+            in.setStatus(QDataStream::ReadCorruptData);
+            return in;
+        }
+
+        in >> format.is_enabled;
+    }
+    else
+    {
+        format.is_enabled = (first_byte != 0);
+    }
+
+    in >> format.name >> format.regexp >> format.hour_index >> format.minute_index
+        >> format.second_index >> format.millisecond_index;
+
+    if (version >= 1)
+    {
+        QString spec;
+        in >> spec >> format.year_index >> format.month_index >> format.day_index
+            >> format.fraction_index >> format.utc_offset_index;
+        format.spec = spec;
+    }
+
+    return in;
 }
 
 timestamp_format_list_t get_default_timestamp_formats()
 {
     timestamp_format_list_t list;
 
-    // Match ss.msec
+    // Match ss.msec, which is also the number of seconds since the epoch
     auto default_format_ss_msec = timestamp_format_t{
         false,
         QObject::tr("ss.msec"),
-        QRegularExpression{"(?:^|\\s)(\\d+)\\.(\\d+)(?:$|\\s)"},
-        -1,
-        -1,
-        1,
-        2};
+        QRegularExpression{"(?:^|\\s)(\\d+)\\.(\\d+)(?:$|\\s)"}};
+    default_format_ss_msec.second_index = 1;
+    default_format_ss_msec.fraction_index = 2;
     list.push_back(default_format_ss_msec);
 
     // Match mm:ss(.msec)
     auto default_format_mm_ss_msec = timestamp_format_t{
         true,
         QObject::tr("mm:ss(.msec)"),
-        QRegularExpression{"(?:^|\\s)(\\d+):(\\d+)(?:\\.(\\d+))?(?:$|\\s)"},
-        -1,
-        1,
-        2,
-        3};
+        QRegularExpression{"(?:^|\\s)(\\d+):(\\d+)(?:\\.(\\d+))?(?:$|\\s)"}};
+    default_format_mm_ss_msec.minute_index = 1;
+    default_format_mm_ss_msec.second_index = 2;
+    default_format_mm_ss_msec.fraction_index = 3;
     list.push_back(default_format_mm_ss_msec);
 
     // Match hh:mm:ss(.msec)
     auto default_format_hh_mm_ss_msec = timestamp_format_t{
         true,
         QObject::tr("hh:mm:ss(.msec)"),
-        QRegularExpression{"(?:^|\\s)(\\d+):(\\d+):(\\d+)(?:\\.(\\d+))?(?:$|\\s)"},
-        1,
-        2,
-        3,
-        4};
+        QRegularExpression{"(?:^|\\s)(\\d+):(\\d+):(\\d+)(?:\\.(\\d+))?(?:$|\\s)"}};
+    default_format_hh_mm_ss_msec.hour_index = 1;
+    default_format_hh_mm_ss_msec.minute_index = 2;
+    default_format_hh_mm_ss_msec.second_index = 3;
+    default_format_hh_mm_ss_msec.fraction_index = 4;
     list.push_back(default_format_hh_mm_ss_msec);
 
-    return list;
-}
+    // Match YYYY-MM-DDThh:mm:ss.fff, without any regular expression
+    auto default_format_iso_8601 = timestamp_format_t{
+        true, QObject::tr("YYYY-MM-DDThh:mm:ss.fff"), QRegularExpression{}};
+    default_format_iso_8601.spec = QStringLiteral("%Y-%m-%dT%H:%M:%S.%f");
+    list.push_back(default_format_iso_8601);
 
-QString timestamp_format_t::match_hour(const QString& s) const
-{
-    return match_index(s, hour_index);
+    return list;
 }
 
-QString timestamp_format_t::match_minute(const QString& s) const
+timestamp_spec_t::timestamp_spec_t(const QString& text)
+    : _text{text}
 {
-    return match_index(s, minute_index);
-}
+    if (_text.isEmpty())
+        return;
 
-QString timestamp_format_t::match_second(const QString& s) const
-{
-    return match_index(s, second_index);
+    // An invalid spec has no parser, so that the regular expression is used instead rather than
+    // finding no timestamp at all.
+    auto parser = std::make_shared<const timestamp_parser_t>(_text);
+    if (parser->is_valid())
+        _parser = std::move(parser);
 }
 
-QString timestamp_format_t::match_millisecond(const QString& s) const
+timestamp_t timestamp_format_t::timestamp_for(const QString& s) const
 {
-    return match_index(s, millisecond_index);
-}
+    if (auto parser = spec.parser())
+        return parser->timestamp_for(s.toUtf8());
 
-QTime timestamp_format_t::time_for(const QString& s) const
-{
     if (!regexp.isValid())
-        return {};
+        return no_timestamp;
 
-    if (auto match = regexp.match(s); !match.hasMatch())
-        return {};
+    const auto match = regexp.match(s);
+    if (!match.hasMatch())
+        return no_timestamp;
+
+    // All the components come from the same match, so the regular expression only runs once.
+    timestamp_fields_t fields;
+    fields.year = captured_number(match, year_index, fields.year);
+    fields.month = captured_number(match, month_index, fields.month);
+    fields.day = captured_number(match, day_index, fields.day);
+    fields.hour = captured_number(match, hour_index);
+    fields.minute = captured_number(match, minute_index);
+    fields.second = captured_number(match, second_index);
+    fields.nanosecond = captured_number(match, millisecond_index) * 1000 * 1000
+        + captured_fraction(match, fraction_index);
+
+    // An offset which isn't captured at all (e.g. an optional group) means UTC, but one which is
+    // captured must be read entirely, otherwise the timestamp would be off by the offset.
+    if (utc_offset_index >= 0)
+    {
+        const QByteArray offset = match.capturedView(utc_offset_index).toUtf8();
+        if (!offset.isEmpty() && (read_utc_offset(offset, fields.utc_offset) != offset.size()))
+            return no_timestamp;
+    }
 
-    // If the capture index does not correspond to anything, a null string is returned.
-    // If the conversion to int fails, 0 is returned.
-    // So in all cases, we end up with 0 in case something goes wrong which is what we
-    // need.
-    auto hours = std::chrono::hours{match_hour(s).toInt()};
-    auto minutes = std::chrono::minutes{match_minute(s).toInt()};
-    auto seconds = std::chrono::seconds{match_second(s).toInt()};
-    auto milliseconds = std::chrono::milliseconds{match_millisecond(s).toInt()};
-
-    auto total = std::chrono::milliseconds{hours + minutes + seconds + milliseconds};
-    return QTime::fromMSecsSinceStartOfDay(total.count());
+    return timestamp_from(fields);
 }
 
 QString timestamp_format_t::match_index(const QString& s, int index) const
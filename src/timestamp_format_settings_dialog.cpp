@@ -1,13 +1,13 @@
 
 #include <flan/timestamp_format_settings_dialog.hpp>
 #include <flan/valid_regular_expression_validator.hpp>
+#include <flan/valid_timestamp_spec_validator.hpp>
 #include <flan/validated_lineedit.hpp>
 #include <QDialogButtonBox>
 #include <QFormLayout>
 #include <QGridLayout>
 #include <QGroupBox>
 #include <QHBoxLayout>
-#include <QTime>
 #include <QToolButton>
 #include <QVBoxLayout>
 #include <chrono>
@@ -105,17 +105,34 @@ timestamp_format_settings_dialog_t::timestamp_format_settings_dialog_t(
     _pattern_lineedit = new validated_lineedit_t;
     _pattern_lineedit->setValidator(new valid_regular_expression_validator_t{_pattern_lineedit});
     _pattern_lineedit->setToolTip(tr("Pattern used to extract individual timestamp information"));
+    _spec_lineedit = new validated_lineedit_t;
+    _spec_lineedit->setValidator(new valid_timestamp_spec_validator_t{_spec_lineedit});
+    _spec_lineedit->setToolTip(
+        tr("Fixed layout of the timestamps, used instead of the pattern when valid. %Y, %m, %d, "
+           "%H, %M and %S match the year, month, day, hour, minute and second, %f the fraction of "
+           "second, %z the offset from UTC, %s the seconds since the epoch and %% a literal %."));
     _hour_widgets = new component_capture_widgets_t{tr("hours")};
     _minute_widgets = new component_capture_widgets_t{tr("minutes")};
     _second_widgets = new component_capture_widgets_t{tr("seconds")};
     _millisecond_widgets = new component_capture_widgets_t{tr("milliseconds")};
+    _year_widgets = new component_capture_widgets_t{tr("year")};
+    _month_widgets = new component_capture_widgets_t{tr("month")};
+    _day_widgets = new component_capture_widgets_t{tr("day")};
+    _fraction_widgets = new component_capture_widgets_t{tr("fraction of second")};
+    _utc_offset_widgets = new component_capture_widgets_t{tr("offset from UTC")};
     auto current_layout = new QFormLayout;
     current_layout->addRow(tr("Name"), _name_lineedit);
     current_layout->addRow(tr("Pattern"), _pattern_lineedit);
+    current_layout->addRow(tr("Spec"), _spec_lineedit);
+    current_layout->addRow(tr("Year"), _year_widgets);
+    current_layout->addRow(tr("Month"), _month_widgets);
+    current_layout->addRow(tr("Day"), _day_widgets);
     current_layout->addRow(tr("Hour"), _hour_widgets);
     current_layout->addRow(tr("Minute"), _minute_widgets);
     current_layout->addRow(tr("Second"), _second_widgets);
     current_layout->addRow(tr("Millisecond"), _millisecond_widgets);
+    current_layout->addRow(tr("Fraction"), _fraction_widgets);
+    current_layout->addRow(tr("UTC offset"), _utc_offset_widgets);
     current_groupbox->setLayout(current_layout);
 
     auto preview_groupbox = new QGroupBox{tr("Preview")};
@@ -166,25 +183,39 @@ timestamp_format_settings_dialog_t::timestamp_format_settings_dialog_t(
         this,
         &timestamp_format_settings_dialog_t::update_current_format_from_widgets);
     connect(
-        _hour_widgets->captured_index_spinbox,
-        &QSpinBox::valueChanged,
+        _spec_lineedit,
+        &QLineEdit::textChanged,
         this,
         &timestamp_format_settings_dialog_t::update_current_format_from_widgets);
     connect(
-        _minute_widgets->captured_index_spinbox,
+        _hour_widgets->captured_index_spinbox,
         &QSpinBox::valueChanged,
         this,
         &timestamp_format_settings_dialog_t::update_current_format_from_widgets);
     connect(
-        _second_widgets->captured_index_spinbox,
+        _minute_widgets->captured_index_spinbox,
         &QSpinBox::valueChanged,
         this,
         &timestamp_format_settings_dialog_t::update_current_format_from_widgets);
     connect(
-        _millisecond_widgets->captured_index_spinbox,
+        _second_widgets->captured_index_spinbox,
         &QSpinBox::valueChanged,
         this,
         &timestamp_format_settings_dialog_t::update_current_format_from_widgets);
+    for (auto widgets:
+         {_millisecond_widgets,
+          _year_widgets,
+          _month_widgets,
+          _day_widgets,
+          _fraction_widgets,
+          _utc_offset_widgets})
+    {
+        connect(
+            widgets->captured_index_spinbox,
+            &QSpinBox::valueChanged,
+            this,
+            &timestamp_format_settings_dialog_t::update_current_format_from_widgets);
+    }
     connect(
         _test_string_lineedit,
         &QLineEdit::textChanged,
@@ -252,7 +283,8 @@ void timestamp_format_settings_dialog_t::update_widgets_from_current_format()
     auto format = current_format();
 
     _name_lineedit->setEnabled(format.has_value());
-    _pattern_lineedit->setEnabled(format.has_value());
+    _pattern_lineedit->setEnabled(format.has_value() && !format->spec.parser());
+    _spec_lineedit->setEnabled(format.has_value());
 
     _test_string_lineedit->setEnabled(format.has_value());
     _preview_label->setEnabled(format.has_value());
@@ -268,6 +300,7 @@ void timestamp_format_settings_dialog_t::update_widgets_from_current_format()
 
         update_lineedit_and_restore_cursor(_name_lineedit, format->name);
         update_lineedit_and_restore_cursor(_pattern_lineedit, format->regexp.pattern());
+        update_lineedit_and_restore_cursor(_spec_lineedit, format->spec.text());
 
         // The spinboxes use -1 for ignore/invalid which is also the value returned by
         // captureCount() if the regexp is invalid.
@@ -275,17 +308,32 @@ void timestamp_format_settings_dialog_t::update_widgets_from_current_format()
 
         auto test_string = _test_string_lineedit->text();
 
+        // The captures are not used by formats with a valid spec.
+        const bool uses_captures = !format->spec.parser();
         _hour_widgets->update(
-            true, capture_count, format->hour_index, format->match_hour(test_string));
+            uses_captures, capture_count, format->hour_index, format->match_hour(test_string));
         _minute_widgets->update(
-            true, capture_count, format->minute_index, format->match_minute(test_string));
+            uses_captures, capture_count, format->minute_index, format->match_minute(test_string));
         _second_widgets->update(
-            true, capture_count, format->second_index, format->match_second(test_string));
+            uses_captures, capture_count, format->second_index, format->match_second(test_string));
         _millisecond_widgets->update(
-            true, capture_count, format->millisecond_index, format->match_millisecond(test_string));
-
-        if (auto time = format->time_for(test_string); time.isValid())
-            combined_preview = time.toString(Qt::ISODateWithMs);
+            uses_captures,
+            capture_count,
+            format->millisecond_index,
+            format->match_millisecond(test_string));
+
+        auto update_component = [&](component_capture_widgets_t* widgets, int index) {
+            widgets->update(
+                uses_captures, capture_count, index, format->match_index(test_string, index));
+        };
+        update_component(_year_widgets, format->year_index);
+        update_component(_month_widgets, format->month_index);
+        update_component(_day_widgets, format->day_index);
+        update_component(_fraction_widgets, format->fraction_index);
+        update_component(_utc_offset_widgets, format->utc_offset_index);
+
+        if (auto timestamp = format->timestamp_for(test_string); timestamp != no_timestamp)
+            combined_preview = timestamp_to_string(timestamp);
     }
     else
     {
@@ -293,6 +341,11 @@ void timestamp_format_settings_dialog_t::update_widgets_from_current_format()
         _minute_widgets->update(false, -1, -1, {});
         _second_widgets->update(false, -1, -1, {});
         _millisecond_widgets->update(false, -1, -1, {});
+        _year_widgets->update(false, -1, -1, {});
+        _month_widgets->update(false, -1, -1, {});
+        _day_widgets->update(false, -1, -1, {});
+        _fraction_widgets->update(false, -1, -1, {});
+        _utc_offset_widgets->update(false, -1, -1, {});
     }
 
     auto preview_label_font = _preview_label->font();
@@ -312,7 +365,13 @@ void timestamp_format_settings_dialog_t::update_current_format_from_widgets()
             _hour_widgets->captured_index_spinbox->value(),
             _minute_widgets->captured_index_spinbox->value(),
             _second_widgets->captured_index_spinbox->value(),
-            _millisecond_widgets->captured_index_spinbox->value()};
+            _millisecond_widgets->captured_index_spinbox->value(),
+            _spec_lineedit->text(),
+            _year_widgets->captured_index_spinbox->value(),
+            _month_widgets->captured_index_spinbox->value(),
+            _day_widgets->captured_index_spinbox->value(),
+            _fraction_widgets->captured_index_spinbox->value(),
+            _utc_offset_widgets->captured_index_spinbox->value()};
 
         item->setData(format_item_data_role_t::format, QVariant::fromValue(format));
         item->setText(format.name);
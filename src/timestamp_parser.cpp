@@ -0,0 +1,308 @@
+#include <flan/timestamp_parser.hpp>
+#include <QtAlgorithms>
+#include <QtEndian>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+namespace flan
+{
+namespace
+{
+bool is_digit(char c)
+{
+    return (c >= '0') && (c <= '9');
+}
+
+//! Return the number of leading digits among the 8 \a bytes, the first byte being the lowest one.
+int leading_digit_count(std::uint64_t bytes)
+{
+    // A byte is a digit if it is 0x3X with X below 10, i.e. if its high nibble is 3 and its low
+    // nibble doesn't overflow when adding 6. Nibbles never carry into the next byte.
+    const std::uint64_t values = bytes ^ 0x3030303030303030;
+    const std::uint64_t non_digits = (values & 0xF0F0F0F0F0F0F0F0)
+        | (((values & 0x0F0F0F0F0F0F0F0F) + 0x0606060606060606) & 0xF0F0F0F0F0F0F0F0);
+
+    return non_digits ? static_cast<int>(qCountTrailingZeroBits(non_digits) / 8) : 8;
+}
+
+//! Return the value of the \a count first digits of \a bytes, the first byte being the lowest one.
+std::uint32_t eight_digits_value(std::uint64_t bytes, int count)
+{
+    // Moving the digits to the high bytes leaves leading zeros in the low bytes. Pairs of digits,
+    // then pairs of pairs, and so on, are then combined with a single multiplication each.
+    bytes = (bytes << (8 * (8 - count))) & 0x0F0F0F0F0F0F0F0F;
+    bytes = (bytes * (10 * 256 + 1)) >> 8;
+    bytes = ((bytes & 0x00FF00FF00FF00FF) * (100 * 65536 + 1)) >> 16;
+    return static_cast<std::uint32_t>(
+        ((bytes & 0x0000FFFF0000FFFF) * ((std::uint64_t{10000} << 32) + 1)) >> 32);
+}
+
+//! Read up to \a max_count digits of \a line starting at \a position into \a value.
+//!
+//! Return the number of digits read. Up to 8 digits are read at once when the line is long enough.
+int read_digits(QByteArrayView line, qsizetype position, int max_count, std::uint64_t& value)
+{
+    const char* data = line.data() + position;
+    const qsizetype available = line.size() - position;
+
+    int count = 0;
+    value = 0;
+    if (available >= 8)
+    {
+        std::uint64_t bytes;
+        std::memcpy(&bytes, data, sizeof(bytes));
+        bytes = qFromLittleEndian(bytes);
+
+        count = std::min(leading_digit_count(bytes), max_count);
+        if (count > 0)
+            value = eight_digits_value(bytes, count);
+    }
+
+    for (; (count < max_count) && (count < available) && is_digit(data[count]); ++count)
+        value = value * 10 + static_cast<std::uint64_t>(data[count] - '0');
+
+    return count;
+}
+} // namespace
+
+timestamp_parser_t::timestamp_parser_t(const QString& spec)
+{
+    QString literal;
+    auto add_field = [&](field_kind_t kind) {
+        if (!literal.isEmpty())
+            _fields.push_back({field_kind_t::literal, literal.toUtf8()});
+        literal.clear();
+
+        if (kind != field_kind_t::literal)
+            _fields.push_back({kind, {}});
+    };
+
+    for (qsizetype i = 0; i < spec.size(); ++i)
+    {
+        if (spec[i] != u'%')
+        {
+            literal.append(spec[i]);
+            continue;
+        }
+
+        if (++i == spec.size())
+        {
+            _fields.clear();
+            return;
+        }
+
+        switch (spec[i].unicode())
+        {
+        case u'Y':
+            add_field(field_kind_t::year);
+            break;
+        case u'm':
+            add_field(field_kind_t::month);
+            break;
+        case u'd':
+            add_field(field_kind_t::day);
+            break;
+        case u'H':
+            add_field(field_kind_t::hour);
+            break;
+        case u'M':
+            add_field(field_kind_t::minute);
+            break;
+        case u'S':
+            add_field(field_kind_t::second);
+            break;
+        case u'f':
+            add_field(field_kind_t::fraction);
+            break;
+        case u'z':
+            add_field(field_kind_t::utc_offset);
+            break;
+        case u's':
+            add_field(field_kind_t::epoch);
+            break;
+        case u'%':
+            literal.append(u'%');
+            break;
+        default:
+            _fields.clear();
+            return;
+        }
+    }
+
+    add_field(field_kind_t::literal);
+}
+
+timestamp_t timestamp_parser_t::timestamp_for(QByteArrayView line) const
+{
+    if (!is_valid())
+        return no_timestamp;
+
+    const auto& first_field = _fields.front();
+    const char* data = line.data();
+    for (qsizetype start = 0; start < line.size(); ++start)
+    {
+        if (first_field.kind == field_kind_t::literal)
+        {
+            // Jump right to the next occurrence of the first byte of the literal.
+            const auto found = static_cast<const char*>(
+                std::memchr(data + start, first_field.literal.front(), line.size() - start));
+            if (!found)
+                break;
+
+            start = found - data;
+        }
+        else if (
+            (first_field.kind != field_kind_t::utc_offset)
+            && (!is_digit(data[start]) || ((start > 0) && is_digit(data[start - 1]))))
+        {
+            // Numbers only start on a digit which doesn't follow another one.
+            continue;
+        }
+
+        qsizetype end = 0;
+        if (auto timestamp = timestamp_at(line, start, end); timestamp != no_timestamp)
+            return timestamp;
+    }
+
+    return no_timestamp;
+}
+
+timestamp_t timestamp_parser_t::exact_timestamp_for(QByteArrayView text) const
+{
+    if (!is_valid())
+        return no_timestamp;
+
+    qsizetype end = 0;
+    const timestamp_t timestamp = timestamp_at(text, 0, end);
+    return (end == text.size()) ? timestamp : no_timestamp;
+}
+
+timestamp_t
+timestamp_parser_t::timestamp_at(QByteArrayView line, qsizetype start, qsizetype& end) const
+{
+    timestamp_fields_t fields;
+
+    qsizetype position = start;
+    for (const auto& field: _fields)
+    {
+        if (field.kind == field_kind_t::literal)
+        {
+            if (!line.sliced(position).startsWith(field.literal))
+                return no_timestamp;
+
+            position += field.literal.size();
+            continue;
+        }
+
+        if (field.kind == field_kind_t::utc_offset)
+        {
+            const int count = read_utc_offset(line.sliced(position), fields.utc_offset);
+            if (count == 0)
+                return no_timestamp;
+
+            position += count;
+            continue;
+        }
+
+        int max_count = 2;
+        if (field.kind == field_kind_t::year)
+            max_count = 4;
+        else if (field.kind == field_kind_t::fraction)
+            max_count = 9;
+        else if (field.kind == field_kind_t::epoch)
+            max_count = 12;
+
+        std::uint64_t value = 0;
+        const int count = read_digits(line, position, max_count, value);
+        const bool has_variable_size =
+            (field.kind == field_kind_t::fraction) || (field.kind == field_kind_t::epoch);
+        if ((count == 0) || (!has_variable_size && (count != max_count)))
+            return no_timestamp;
+
+        position += count;
+        const auto number = static_cast<qint64>(value);
+        switch (field.kind)
+        {
+        case field_kind_t::year:
+            fields.year = number;
+            break;
+        case field_kind_t::month:
+            if ((number < 1) || (number > 12))
+                return no_timestamp;
+            fields.month = number;
+            break;
+        case field_kind_t::day:
+            if ((number < 1) || (number > 31))
+                return no_timestamp;
+            fields.day = number;
+            break;
+        case field_kind_t::hour:
+            if (number > 23)
+                return no_timestamp;
+            fields.hour = number;
+            break;
+        case field_kind_t::minute:
+            if (number > 59)
+                return no_timestamp;
+            fields.minute = number;
+            break;
+        case field_kind_t::second:
+            // Allow leap seconds.
+            if (number > 60)
+                return no_timestamp;
+            fields.second = number;
+            break;
+        case field_kind_t::fraction:
+            fields.nanosecond = number;
+            for (int i = count; i < 9; ++i)
+                fields.nanosecond *= 10;
+            break;
+        case field_kind_t::epoch:
+            fields.second = number;
+            break;
+        default:
+            break;
+        }
+    }
+
+    // Don't match the start of a longer number.
+    if ((_fields.back().kind != field_kind_t::literal) && (position < line.size())
+        && is_digit(line[position]))
+        return no_timestamp;
+
+    end = position;
+    return timestamp_from(fields);
+}
+
+int read_utc_offset(QByteArrayView text, qint64& offset)
+{
+    if (text.isEmpty())
+        return 0;
+
+    if ((text[0] == 'Z') || (text[0] == 'z'))
+    {
+        offset = 0;
+        return 1;
+    }
+
+    if ((text[0] != '+') && (text[0] != '-'))
+        return 0;
+
+    std::uint64_t hours = 0;
+    if ((read_digits(text, 1, 2, hours) != 2) || (hours > 23))
+        return 0;
+
+    // The minutes are optional, with or without a colon before them.
+    int count = 3;
+    std::uint64_t minutes = 0;
+    const qsizetype minutes_position = ((text.size() > 3) && (text[3] == ':')) ? 4 : 3;
+    if ((read_digits(text, minutes_position, 2, minutes) == 2) && (minutes <= 59))
+        count = static_cast<int>(minutes_position) + 2;
+    else
+        minutes = 0;
+
+    offset = static_cast<qint64>(hours * 3600 + minutes * 60) * ((text[0] == '-') ? -1 : 1);
+    return count;
+}
+} // namespace flan
@@ -0,0 +1,249 @@
+#include <flan/line_visibility.hpp>
+#include <flan/required_literals.hpp>
+#include <flan/timestamp_format.hpp>
+#include <flan/timestamp_parser.hpp>
+#include <QTest>
+#include <cstdint>
+#include <vector>
+
+namespace flan
+{
+namespace
+{
+//! Return the visibility of \a line_count lines where only the \a shown_lines are shown.
+line_visibility_t
+visibility_for(std::size_t line_count, const std::vector<std::size_t>& shown_lines)
+{
+    std::vector<std::uint64_t> words((line_count + 63) / 64, 0);
+    for (auto line: shown_lines)
+        words[line / 64] |= std::uint64_t{1} << (line % 64);
+
+    line_visibility_t visibility;
+    visibility.append(words, line_count);
+    return visibility;
+}
+
+timestamp_t time_of_day(qint64 hour, qint64 minute, qint64 second, qint64 nanosecond = 0)
+{
+    return ((hour * 60 + minute) * 60 + second) * nanoseconds_per_second + nanosecond;
+}
+} // namespace
+
+class flan_test_t : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void rank_and_select_at_word_boundaries();
+    void rank_and_select_across_empty_words();
+    void rank_and_select_after_appending_within_a_word();
+    void rank_and_select_after_removing_lines();
+
+    void literals_of_alternations();
+    void no_literals_for_optional_alternatives();
+    void no_literals_for_case_insensitive_patterns();
+
+    void spec_with_fraction();
+    void spec_with_utc_offset();
+    void spec_matching_whole_text();
+    void invalid_spec();
+    void captured_utc_offset();
+};
+
+void flan_test_t::rank_and_select_at_word_boundaries()
+{
+    const auto visibility = visibility_for(130, {0, 63, 64, 127, 128});
+    QCOMPARE(visibility.line_count(), std::size_t{130});
+    QCOMPARE(visibility.shown_line_count(), std::size_t{5});
+
+    QCOMPARE(visibility.rank(0), std::size_t{0});
+    QCOMPARE(visibility.rank(1), std::size_t{1});
+    QCOMPARE(visibility.rank(63), std::size_t{1});
+    QCOMPARE(visibility.rank(64), std::size_t{2});
+    QCOMPARE(visibility.rank(65), std::size_t{3});
+    QCOMPARE(visibility.rank(127), std::size_t{3});
+    QCOMPARE(visibility.rank(128), std::size_t{4});
+    QCOMPARE(visibility.rank(129), std::size_t{5});
+    QCOMPARE(visibility.rank(130), std::size_t{5});
+
+    QCOMPARE(visibility.select(0), std::size_t{0});
+    QCOMPARE(visibility.select(1), std::size_t{63});
+    QCOMPARE(visibility.select(2), std::size_t{64});
+    QCOMPARE(visibility.select(3), std::size_t{127});
+    QCOMPARE(visibility.select(4), std::size_t{128});
+}
+
+void flan_test_t::rank_and_select_across_empty_words()
+{
+    const auto visibility = visibility_for(260, {0, 200, 259});
+    QCOMPARE(visibility.shown_line_count(), std::size_t{3});
+
+    QCOMPARE(visibility.rank(64), std::size_t{1});
+    QCOMPARE(visibility.rank(200), std::size_t{1});
+    QCOMPARE(visibility.rank(201), std::size_t{2});
+    QCOMPARE(visibility.rank(259), std::size_t{2});
+
+    QCOMPARE(visibility.select(1), std::size_t{200});
+    QCOMPARE(visibility.select(2), std::size_t{259});
+}
+
+void flan_test_t::rank_and_select_after_appending_within_a_word()
+{
+    auto visibility = visibility_for(100, {63, 99});
+
+    // The next lines start in the middle of the word holding lines 64 to 127.
+    std::vector<std::uint64_t> words(1, 0);
+    words[0] |= std::uint64_t{1} << (100 - 64);
+    words[0] |= std::uint64_t{1} << (127 - 64);
+    visibility.append(words, 128);
+
+    QCOMPARE(visibility.line_count(), std::size_t{128});
+    QCOMPARE(visibility.shown_line_count(), std::size_t{4});
+    QVERIFY(visibility.is_shown(99));
+    QVERIFY(visibility.is_shown(100));
+    QVERIFY(!visibility.is_shown(101));
+
+    QCOMPARE(visibility.rank(100), std::size_t{2});
+    QCOMPARE(visibility.rank(127), std::size_t{3});
+    QCOMPARE(visibility.select(1), std::size_t{99});
+    QCOMPARE(visibility.select(2), std::size_t{100});
+    QCOMPARE(visibility.select(3), std::size_t{127});
+}
+
+void flan_test_t::rank_and_select_after_removing_lines()
+{
+    auto visibility = visibility_for(130, {0, 63, 64, 127, 128});
+
+    // The remaining lines move across word boundaries.
+    visibility.remove_first_lines(63);
+    QCOMPARE(visibility.line_count(), std::size_t{67});
+    QCOMPARE(visibility.shown_line_count(), std::size_t{4});
+
+    QVERIFY(visibility.is_shown(0));
+    QVERIFY(visibility.is_shown(1));
+    QVERIFY(!visibility.is_shown(2));
+    QCOMPARE(visibility.rank(2), std::size_t{2});
+    QCOMPARE(visibility.rank(64), std::size_t{2});
+    QCOMPARE(visibility.select(2), std::size_t{64});
+    QCOMPARE(visibility.select(3), std::size_t{65});
+}
+
+void flan_test_t::literals_of_alternations()
+{
+    QCOMPARE(
+        required_literals(QRegularExpression{"error|warning"}),
+        (QStringList{"error", "warning"}));
+
+    // Optional characters and character classes end the literals.
+    QCOMPARE(required_literals(QRegularExpression{"colou?r|gr[ae]y"}), (QStringList{"colo", "gr"}));
+
+    // Alternatives in a group are not at the top level.
+    QCOMPARE(
+        required_literals(QRegularExpression{"(connection|socket) closed"}),
+        QStringList{" closed"});
+}
+
+void flan_test_t::no_literals_for_optional_alternatives()
+{
+    QVERIFY(required_literals(QRegularExpression{"error|.*"}).isEmpty());
+    QVERIFY(required_literals(QRegularExpression{"error|"}).isEmpty());
+}
+
+void flan_test_t::no_literals_for_case_insensitive_patterns()
+{
+    QVERIFY(required_literals(
+                QRegularExpression{"error|warning", QRegularExpression::CaseInsensitiveOption})
+                .isEmpty());
+    QVERIFY(required_literals(QRegularExpression{"(?i)error|warning"}).isEmpty());
+    QVERIFY(required_literals(QRegularExpression{"error (?i)code"}).isEmpty());
+}
+
+void flan_test_t::spec_with_fraction()
+{
+    const timestamp_parser_t parser{"%H:%M:%S.%f"};
+    QVERIFY(parser.is_valid());
+
+    QCOMPARE(parser.timestamp_for("at 12:34:56.5 done"), time_of_day(12, 34, 56, 500000000));
+    QCOMPARE(parser.timestamp_for("12:34:56.05"), time_of_day(12, 34, 56, 50000000));
+    QCOMPARE(parser.timestamp_for("12:34:56.123456789"), time_of_day(12, 34, 56, 123456789));
+
+    // At most 9 digits are read, and a timestamp is never the start of a longer number.
+    QCOMPARE(parser.timestamp_for("12:34:56.1234567891"), no_timestamp);
+    QCOMPARE(parser.timestamp_for("12:34:56."), no_timestamp);
+
+    const timestamp_parser_t epoch_parser{"%s.%f"};
+    QCOMPARE(
+        epoch_parser.timestamp_for("t=1700000000.25"),
+        timestamp_t{1700000000} * nanoseconds_per_second + 250000000);
+}
+
+void flan_test_t::spec_with_utc_offset()
+{
+    timestamp_fields_t fields;
+    fields.year = 2024;
+    fields.month = 5;
+    fields.day = 1;
+    fields.hour = 12;
+    fields.minute = 32;
+    fields.second = 7;
+    const timestamp_t utc = timestamp_from(fields);
+
+    const timestamp_parser_t parser{"%Y-%m-%dT%H:%M:%S%z"};
+    QCOMPARE(parser.timestamp_for("2024-05-01T12:32:07Z"), utc);
+    QCOMPARE(parser.timestamp_for("2024-05-01T14:32:07+02:00"), utc);
+    QCOMPARE(parser.timestamp_for("2024-05-01T14:32:07+0200"), utc);
+    QCOMPARE(parser.timestamp_for("2024-05-01T14:32:07+02"), utc);
+    QCOMPARE(parser.timestamp_for("2024-05-01T11:02:07-01:30"), utc);
+
+    // The offset is required by the spec.
+    QCOMPARE(parser.timestamp_for("2024-05-01T12:32:07"), no_timestamp);
+    QCOMPARE(parser.timestamp_for("2024-05-01T12:32:07+2"), no_timestamp);
+}
+
+void flan_test_t::spec_matching_whole_text()
+{
+    const timestamp_parser_t parser{"%H:%M:%S"};
+    QCOMPARE(parser.exact_timestamp_for("14:32:07"), time_of_day(14, 32, 7));
+    QCOMPARE(parser.exact_timestamp_for("14:32:07 tomorrow"), no_timestamp);
+    QCOMPARE(parser.exact_timestamp_for("at 14:32:07"), no_timestamp);
+    QCOMPARE(parser.timestamp_for("14:32:07 tomorrow"), time_of_day(14, 32, 7));
+}
+
+void flan_test_t::invalid_spec()
+{
+    QVERIFY(!timestamp_parser_t{""}.is_valid());
+    QVERIFY(!timestamp_parser_t{"%H:%q"}.is_valid());
+    QVERIFY(!timestamp_parser_t{"%H:%"}.is_valid());
+    QVERIFY(timestamp_parser_t{"%H%%"}.is_valid());
+
+    // A format with an invalid spec uses its regular expression instead.
+    timestamp_format_t format;
+    format.regexp = QRegularExpression{"(\\d+):(\\d+)"};
+    format.minute_index = 1;
+    format.second_index = 2;
+    format.spec = QStringLiteral("%M:%q");
+    QVERIFY(!format.spec.parser());
+    QCOMPARE(format.timestamp_for("12:34"), time_of_day(0, 12, 34));
+}
+
+void flan_test_t::captured_utc_offset()
+{
+    timestamp_format_t format;
+    format.regexp = QRegularExpression{"(\\d+):(\\d+):(\\d+)(\\S*)"};
+    format.hour_index = 1;
+    format.minute_index = 2;
+    format.second_index = 3;
+    format.utc_offset_index = 4;
+
+    QCOMPARE(format.timestamp_for("10:00:00+02:00"), time_of_day(8, 0, 0));
+    QCOMPARE(format.timestamp_for("10:00:00Z"), time_of_day(10, 0, 0));
+
+    // Nothing captured means UTC, but an invalid offset means no timestamp.
+    QCOMPARE(format.timestamp_for("10:00:00"), time_of_day(10, 0, 0));
+    QCOMPARE(format.timestamp_for("10:00:00CEST"), no_timestamp);
+}
+} // namespace flan
+
+QTEST_GUILESS_MAIN(flan::flan_test_t)
+
+#include "flan_test.moc"